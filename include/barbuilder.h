@@ -0,0 +1,114 @@
+#ifndef BARBUILDER_H
+#define BARBUILDER_H
+
+#include <QtGlobal>
+#include <QVector>
+
+/**
+ * @brief 单根K线（OHLCV）
+ */
+struct StockBar
+{
+    qint64 time = 0;      // 周期起始时间（毫秒）
+    double open = 0.0;
+    double high = 0.0;
+    double low = 0.0;
+    double close = 0.0;
+    qint64 volume = 0;    // 周期内成交量（手）
+};
+
+/**
+ * @brief 紧凑的K线数组，按列存放，可直接交给 QCPFinancial::setData()
+ */
+struct BarSeries
+{
+    QVector<double> keys;   // 周期起始时间（秒），与图表横轴单位一致
+    QVector<double> open;
+    QVector<double> high;
+    QVector<double> low;
+    QVector<double> close;
+    QVector<double> volume;
+
+    int size() const { return keys.size(); }
+    bool isEmpty() const { return keys.isEmpty(); }
+    void reserve(int count);
+    void clear();
+    void append(const StockBar &bar);
+};
+
+/**
+ * @brief 流式K线构建器
+ *
+ * 按时间顺序逐笔喂入tick，原地更新当前K线，跨周期时开始新的K线。
+ * 成交量按腾讯接口的日内累计量计算差值，累计量回落（跨日）时从零重新累计。
+ */
+class BarBuilder
+{
+public:
+    /**
+     * @brief 单笔tick的处理结果
+     */
+    enum TickResult {
+        Ignored,  // 早于当前K线的乱序数据，已丢弃
+        Updated,  // 更新了当前K线
+        NewBar,   // 开始了新的K线，上一根可通过 lastClosedBar() 取得
+    };
+
+    /**
+     * @param intervalMs 周期长度（毫秒）
+     * @param utcOffsetMs 本地时区偏移（毫秒），用于日线等按本地时间对齐
+     */
+    explicit BarBuilder(qint64 intervalMs, qint64 utcOffsetMs = 0);
+
+    /**
+     * @brief 追加一笔tick
+     * @param timestamp 时间戳（毫秒）
+     * @param price 成交价
+     * @param cumulativeVolume 日内累计成交量
+     */
+    TickResult addTick(qint64 timestamp, double price, qint64 cumulativeVolume);
+
+    /**
+     * @brief 清空状态，重新开始构建
+     */
+    void reset();
+
+    /**
+     * @brief 从已有的K线（如从数据库读出的最后一根）继续构建
+     *
+     * 没有累计成交量基准，续上的第一笔tick成交量记为0。
+     */
+    void resume(const StockBar &bar);
+
+    /**
+     * @brief 计算时间戳所在周期的起始时间（毫秒）
+     */
+    qint64 bucketStart(qint64 timestamp) const;
+
+    qint64 interval() const { return m_intervalMs; }
+    bool hasBar() const { return m_hasBar; }
+    bool hasClosedBar() const { return m_hasClosedBar; }
+    const StockBar &currentBar() const { return m_current; }
+    const StockBar &lastClosedBar() const { return m_closed; }
+
+    /**
+     * @brief 按周期对齐时间戳，返回所在周期的起始时间（毫秒）
+     */
+    static qint64 alignTimestamp(qint64 timestamp, qint64 intervalMs, qint64 utcOffsetMs);
+
+    /**
+     * @brief 当前时区相对UTC的偏移（毫秒）
+     */
+    static qint64 localUtcOffsetMs();
+
+private:
+    qint64 m_intervalMs;
+    qint64 m_utcOffsetMs;
+    qint64 m_lastCumulativeVolume;
+    bool m_hasBar;
+    bool m_hasClosedBar;
+    StockBar m_current;
+    StockBar m_closed;
+};
+
+#endif // BARBUILDER_H
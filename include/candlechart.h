@@ -0,0 +1,68 @@
+#ifndef CANDLECHART_H
+#define CANDLECHART_H
+
+#include <QObject>
+#include <QString>
+
+#include "barbuilder.h"
+
+class QCustomPlot;
+class QCPFinancial;
+class QCPRange;
+
+/**
+ * @brief K线图
+ *
+ * 在已有的QCustomPlot上用QCPFinancial绘制蜡烛图。切换股票或周期时从数据库读取最近的K线，
+ * 之后每笔tick交给流式K线构建器，原地更新最后一根K线或追加新K线，不重建数据。
+ * 向左拖动超出已加载范围时按页读取更早的K线。
+ */
+class CandleChart : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CandleChart(QCustomPlot *plot, QObject *parent = nullptr);
+
+    // 显示或隐藏K线，显示时按当前股票和周期重新加载
+    void setActive(bool active);
+    bool isActive() const { return m_active; }
+
+    void setSymbol(const QString &stockCode);
+    QString symbol() const { return m_stockCode; }
+
+    // K线周期（秒）
+    void setInterval(int intervalSecs);
+    int interval() const { return m_intervalSecs; }
+
+    /**
+     * @brief 追加一笔tick，只更新内存中的K线，图表在refresh()时重绘
+     * @param timestamp 时间戳（毫秒）
+     * @param cumulativeVolume 日内累计成交量
+     */
+    void addTick(qint64 timestamp, double price, qint64 cumulativeVolume);
+
+    // 把新数据反映到图表上，坐标范围不变时只重绘曲线层
+    void refresh();
+
+private slots:
+    void onRangeChanged(const QCPRange &range);
+
+private:
+    void reload();
+    void loadOlder();
+    // 纵轴范围不足以容纳可见K线时调整，force为true时总是按可见K线重设
+    bool fitValueRange(bool force = false);
+
+    QCustomPlot *m_plot;
+    QCPFinancial *m_financial;
+    BarBuilder m_builder;
+    QString m_stockCode;
+    int m_intervalSecs;
+    bool m_active;
+    bool m_dirty;        // 有新tick尚未重绘
+    bool m_exhausted;    // 更早的K线已全部加载
+    bool m_adjusting;    // 程序调整坐标范围时不触发分页
+};
+
+#endif // CANDLECHART_H
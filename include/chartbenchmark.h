@@ -0,0 +1,25 @@
+#ifndef CHARTBENCHMARK_H
+#define CHARTBENCHMARK_H
+
+/**
+ * @brief 图表绘制帧率测试
+ *
+ * 生成指定点数的随机游走序列，在1280x720的图表中平移可见范围并连续重绘，
+ * 依次测试软件绘制、OpenGL绘制（编译时启用且能创建上下文时）以及金字塔抽稀后的绘制，
+ * 每种方式输出每秒帧数。需要在QApplication创建之后调用。
+ */
+class ChartBenchmark
+{
+public:
+    static int run(int points, int frames = 200);
+
+    /**
+     * @brief 对比分时图收到新点时的两种更新方式
+     *
+     * 序列保持points个点，逐个追加updates个新点：增量方式只追加新点并重绘曲线所在的层，
+     * 全量方式每次setData()整个序列并重绘整个图表。输出每次更新的平均耗时。
+     */
+    static int runUpdate(int points, int updates = 500);
+};
+
+#endif // CHARTBENCHMARK_H
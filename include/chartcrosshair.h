@@ -0,0 +1,51 @@
+#ifndef CHARTCROSSHAIR_H
+#define CHARTCROSSHAIR_H
+
+#include <QObject>
+#include <QPoint>
+
+class QCustomPlot;
+class QCPItemStraightLine;
+class QCPItemTracer;
+class QCPItemText;
+class QMouseEvent;
+class QTimer;
+
+/**
+ * @brief 图表十字光标和数值提示
+ *
+ * 鼠标在坐标区内移动时，在可见曲线（分时线或K线）中找到时间上最近的点，
+ * 画出十字线、标记点和时间价格提示。数据按时间有序，最近点用二分查找，与点数无关。
+ * 所有元素都在单独缓冲的overlay层上，移动时只重绘这一层；鼠标事件先记下位置，
+ * 按屏幕刷新率合并后再更新。
+ */
+class ChartCrosshair : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ChartCrosshair(QCustomPlot *plot, QObject *parent = nullptr);
+
+    void setDarkTheme(bool dark);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void onMouseMove(QMouseEvent *event);
+    void updateCrosshair();
+
+private:
+    void setVisible(bool visible);
+
+    QCustomPlot *m_plot;
+    QCPItemStraightLine *m_verticalLine;
+    QCPItemStraightLine *m_horizontalLine;
+    QCPItemTracer *m_tracer;
+    QCPItemText *m_label;
+    QTimer *m_throttle;       // 合并同一帧内的多次移动
+    QPoint m_mousePos;
+    bool m_hovering;
+};
+
+#endif // CHARTCROSSHAIR_H
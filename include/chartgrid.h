@@ -0,0 +1,78 @@
+#ifndef CHARTGRID_H
+#define CHARTGRID_H
+
+#include <QWidget>
+#include <QImage>
+#include <QStringList>
+#include <QVector>
+#include <QSet>
+#include <QHash>
+
+class TimeSeriesStore;
+
+/**
+ * @brief 多股票分时小图墙
+ *
+ * 一个控件绘制最多64只股票的分时小图，不为每只股票创建QCustomPlot。
+ * 所有小图画在同一张后备图像上，行情更新只重画有变化的格子，
+ * paintEvent只把图像贴到屏幕上。每格的曲线按像素列取最小/最大值，绘制开销只与格子宽度有关。
+ * 双击格子发出symbolActivated信号。
+ */
+class ChartGrid : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static const int MaxCharts = 64;
+
+    explicit ChartGrid(TimeSeriesStore *store, QWidget *parent = nullptr);
+
+    // 显示的股票，超过MaxCharts时只取前面的部分
+    void setSymbols(const QStringList &stockCodes);
+    QStringList symbols() const { return m_stockCodes; }
+
+    void setDarkTheme(bool dark);
+
+    // 标记股票有新数据，下一次refresh()时重画
+    void markDirty(const QString &stockCode);
+    bool contains(const QString &stockCode) const { return m_cellIndex.contains(stockCode); }
+
+    // 重画有变化的格子并更新屏幕，按帧调用
+    void refresh();
+
+signals:
+    void symbolActivated(const QString &stockCode);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    QRect cellRect(int index) const;
+    void drawCell(QPainter &painter, int index);
+    void markAllDirty();
+    void touchSymbols();
+
+    TimeSeriesStore *m_store;
+    QStringList m_stockCodes;
+    QHash<QString, int> m_cellIndex;
+    QSet<int> m_dirtyCells;
+    QImage m_image;            // 所有小图共用的后备图像
+    int m_columns;
+    int m_rows;
+    bool m_darkTheme;
+
+    // 复用的缓冲，避免每格每帧分配
+    QVector<double> m_keys;
+    QVector<double> m_values;
+    QVector<QPointF> m_points;
+
+    // 每帧耗时统计
+    qint64 m_frameNs;
+    int m_frameCount;
+    int m_cellsDrawn;
+};
+
+#endif // CHARTGRID_H
@@ -0,0 +1,160 @@
+#ifndef COLUMNARTICKSTORE_H
+#define COLUMNARTICKSTORE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QFile>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+
+/**
+ * @brief 按股票分文件的列式tick存储
+ *
+ * 每只股票一个只追加的文件（数据目录 columnar/<代码>.tkc），由文件头和定长数据块组成。
+ * 每块最多256笔tick，时间和价格以块内首笔为基准存储差值（价格为定点数），
+ * 成交量按原始累计值存储。块头记录块内首末时间，定长块本身就是稀疏时间索引，
+ * 读取时对映射内存二分查找起始块，范围扫描不经过SQLite也不复制原始数据。
+ */
+class ColumnarTickStore
+{
+public:
+    enum {
+        BlockCapacity = 256,    // 每块最多的tick数
+        PriceScale = 1000,      // 价格定点倍数，保留3位小数
+    };
+
+    /**
+     * @brief 文件头，固定64字节
+     */
+    struct FileHeader {
+        char magic[4];          // "TKC1"
+        quint32 version;
+        quint32 blockCapacity;
+        quint32 priceScale;
+        qint64 reserved[6];
+    };
+
+    /**
+     * @brief 定长数据块，按列存放，块内各列可直接向量化解码
+     */
+    struct Block {
+        qint64 baseTime;                    // 块内首笔时间（毫秒）
+        qint64 lastTime;                    // 块内末笔时间（毫秒）
+        qint64 basePrice;                   // 块内首笔价格（定点）
+        quint32 count;                      // 块内tick数
+        quint32 reserved;
+        quint32 timeDelta[BlockCapacity];   // 相对baseTime的毫秒差
+        qint32 priceDelta[BlockCapacity];   // 相对basePrice的定点差
+        qint64 volume[BlockCapacity];       // 日内累计成交量
+
+        qint64 time(int index) const { return baseTime + timeDelta[index]; }
+        double price(int index) const { return (basePrice + priceDelta[index]) / double(PriceScale); }
+    };
+
+    /**
+     * @brief 只读映射一个列式文件，析构时解除映射。可在任意线程中创建，
+     * 映射的是创建时的文件长度，之后追加的数据需重新创建读取器才能看到。
+     */
+    class Reader {
+    public:
+        explicit Reader(const QString &path);
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        bool isOpen() const { return m_blocks != nullptr; }
+        int blockCount() const { return m_blockCount; }
+        const Block &block(int index) const { return m_blocks[index]; }
+
+        // 第一个末笔时间不早于timestamp的块，没有时返回blockCount()
+        int seekBlock(qint64 timestamp) const;
+
+        // 最后一个首笔时间不晚于timestamp的块，没有时返回-1
+        int lastBlockBefore(qint64 timestamp) const;
+
+        // 按时间顺序访问[fromMs, toMs]内的tick，visitor(时间, 价格, 累计成交量)
+        template <typename Visitor>
+        void forEachTick(qint64 fromMs, qint64 toMs, Visitor &&visitor) const
+        {
+            for (int b = seekBlock(fromMs); b < m_blockCount; ++b) {
+                const Block &blk = m_blocks[b];
+                if (blk.baseTime > toMs) {
+                    break;
+                }
+                const int count = int(qMin<quint32>(blk.count, BlockCapacity));
+                for (int i = 0; i < count; ++i) {
+                    const qint64 timestamp = blk.time(i);
+                    if (timestamp < fromMs) {
+                        continue;
+                    }
+                    if (timestamp > toMs) {
+                        return;
+                    }
+                    visitor(timestamp, blk.price(i), blk.volume[i]);
+                }
+            }
+        }
+
+        // 把[fromMs, toMs]内的tick解码为图表使用的时间（秒）和价格数组，返回追加的点数
+        int readSeries(qint64 fromMs, qint64 toMs, QVector<double> &keys, QVector<double> &prices) const;
+
+    private:
+        QFile m_file;
+        uchar *m_map = nullptr;
+        const Block *m_blocks = nullptr;
+        int m_blockCount = 0;
+    };
+
+    /**
+     * @brief 向列式文件追加tick，尾块缓存在内存中。
+     * append()在块写满时落盘，flush()只写出尾块中新增的部分；文件在首次追加时打开并保持打开。
+     */
+    class Writer {
+    public:
+        Writer() = default;
+        explicit Writer(const QString &path);
+
+        // 追加一笔tick，时间早于上一笔时拒绝
+        bool append(qint64 timestamp, double price, qint64 volume);
+        bool flush();
+
+        // 最后一笔tick的时间，空文件返回最小值
+        qint64 lastTime();
+
+    private:
+        bool load();
+        bool writeTail();
+
+        QString m_path;
+        QSharedPointer<QFile> m_file;   // 写入器存放在容器中会被复制，共用同一个打开的文件
+        Block m_tail = {};
+        qint64 m_tailOffset = -1;   // 尾块在文件中的偏移，-1表示尚未加载
+        quint32 m_written = 0;      // 尾块中已写入文件的tick数
+        bool m_dirty = false;
+    };
+
+    /**
+     * @brief 列式文件目录，不存在时创建
+     */
+    static QString directory();
+
+    /**
+     * @brief 股票对应的列式文件路径
+     */
+    static QString filePath(const QString &stockCode);
+
+    /**
+     * @brief 已有列式文件的所有股票代码
+     */
+    static QStringList stockCodes();
+
+    /**
+     * @brief 把数据库各tick表中的数据转换为列式文件，已有文件会被重新生成
+     * @return 转换的股票数
+     */
+    static int convertFromDatabase(QSqlDatabase &db, const QString &attachedKey = QString());
+};
+
+#endif // COLUMNARTICKSTORE_H
@@ -9,17 +9,36 @@
 #include <QString>
 #include <QDateTime>
 #include <QDebug>
+#include <QHash>
+#include <functional>
+
+#include "barbuilder.h"
+#include "columnartickstore.h"
+
+struct TickRows;
+class QTimer;
 
 class DatabaseHelper : public QObject
 {
     Q_OBJECT
 
 public:
+    // tick存储方式
+    enum StorageMode {
+        SingleFile,        // 全部写入 ticker_data.db
+        DailyPartitions,   // 每个交易日一个分区文件
+        WeeklyPartitions,  // 每周一个分区文件
+        Columnar,          // 每只股票一个列式文件，K线仍写入 ticker_data.db
+    };
+
     static DatabaseHelper& instance();
 
     // 初始化数据库
     bool initializeDatabase();
 
+    // 在后台线程中建表、建索引，之后主线程的initializeDatabase()只需打开连接和预编译语句
+    static bool prepareSchema();
+
     // 保存股票数据
     bool saveStockData(const QString &stockCode, const QString &name, 
                       double price, double prevClose, double change, 
@@ -32,9 +51,108 @@ public:
                                      const QDateTime &startTime = QDateTime(), 
                                      const QDateTime &endTime = QDateTime());
 
+    // 按任意周期聚合K线（OHLCV），intervalSecs为周期秒数
+    BarSeries getStockBars(const QString &stockCode, int intervalSecs,
+                           const QDateTime &startTime = QDateTime(),
+                           const QDateTime &endTime = QDateTime());
+
     // 获取所有股票代码
     QStringList getAllStockCodes();
 
+    // 从原始tick重建K线物化表，按股票并行，返回成功重建的股票数
+    int rebuildBars(const QStringList &stockCodes = QStringList());
+
+    // K线表为空（新库或旧库首次升级），需要从已有tick生成；初始化时不自动重建，由调用方选择线程
+    bool needsBarRebuild() const { return m_needsBarRebuild; }
+
+    /**
+     * 重建指定股票的K线，每只股票使用独立连接，可在后台线程调用。
+     * progress在工作线程中调用，参数为已完成的股票数和总数。完成后须在主线程调用resetBarBaseline()。
+     */
+    static int rebuildBarsForSymbols(const QStringList &stockCodes,
+                                     const std::function<void(int finished, int total)> &progress = nullptr);
+
+    // 重建后的K线已包含已保存tick的全部成交量，清除内存中的增量基准
+    void resetBarBaseline();
+
+    // 把各tick表中的数据转换为列式文件，返回转换的股票数
+    int convertToColumnar();
+
+    // 把全部tick导出为压缩归档文件（.tkz）
+    bool exportTicks(const QString &fileName);
+
+    // 物化维护的K线周期（秒）：1分钟、5分钟、1小时、1天
+    static const QList<int> &barIntervals();
+
+    // 数据目录，不存在时创建
+    static QString dataDirectory();
+
+    // 主库文件路径
+    static QString defaultDatabasePath();
+
+    // 数据库文件路径，初始化后有效
+    QString databasePath() const { return m_dbPath; }
+
+    // 当前存储方式，初始化时从数据目录的 tickerlite.ini 读取
+    StorageMode storageMode() const { return m_storageMode; }
+    bool isPartitioned() const { return m_storageMode == DailyPartitions || m_storageMode == WeeklyPartitions; }
+
+    // 保存存储方式，下次启动生效
+    static bool saveStorageMode(StorageMode mode);
+
+    // 挂载/卸载附加数据库，不能在事务中调用；readOnly时以只读方式挂载（连接须允许URI文件名）
+    static bool attachDatabase(QSqlDatabase &db, const QString &path, const QString &alias,
+                               bool readOnly = false);
+    static void detachDatabase(QSqlDatabase &db, const QString &alias);
+
+    // 在指定schema中创建tick表及其联合索引
+    static bool createTickTable(QSqlDatabase &db, const QString &schema);
+
+    // 列出表中的所有股票代码，沿索引逐个跳跃，代价与股票数成正比
+    static QStringList listStockCodes(QSqlDatabase &db, const QString &table = "stock_bars");
+
+    /**
+     * 按时间顺序遍历与[fromMs, toMs]重叠的tick表，回调参数为带schema的表名，
+     * 返回false时停止遍历。分区模式下按需挂载分区，回调返回前须释放对该表的查询。
+     * 已压缩的分区不挂载，以归档文件路径调用archiveVisitor，由调用方用TickArchive直接解码。
+     * attachedKey为已作为cur挂载的写入分区，避免重复挂载。
+     */
+    static void forEachTickTable(QSqlDatabase &db, qint64 fromMs, qint64 toMs, bool newestFirst,
+                                 const std::function<bool(const QString &table)> &visitor,
+                                 const std::function<bool(const QString &archivePath)> &archiveVisitor,
+                                 const QString &attachedKey = QString());
+
+    // 把[fromMs, toMs)内的原始tick聚合为各物化周期的K线，下标与barIntervals()一致；
+    // table为空时遍历所有tick表，列式模式下读取列式文件
+    static bool aggregateTicks(QSqlDatabase &db, const QString &stockCode,
+                               qint64 fromMs, qint64 toMs,
+                               QVector<QVector<StockBar>> &bars,
+                               const QString &table = QString());
+
+    // 把一只股票已解码的tick（如压缩分区的归档）中[fromMs, toMs)的部分聚合为各物化周期的K线
+    static void aggregateTicks(const TickRows &rows, qint64 fromMs, qint64 toMs,
+                               QVector<QVector<StockBar>> &bars);
+
+    // 写入K线，replaceExisting为false时保留已有K线，需在调用方事务中执行
+    static bool writeBars(QSqlDatabase &db, const QString &stockCode,
+                          const QVector<QVector<StockBar>> &bars, bool replaceExisting);
+
+    /**
+     * 工作线程专用的数据库连接，析构时自动关闭并移除。
+     * 同一连接只能在创建它的线程中使用，使用它的QSqlQuery须先于它析构。
+     */
+    class Connection {
+    public:
+        // databasePath为空时连接主库
+        explicit Connection(const QString &connectionName, const QString &databasePath = QString());
+        ~Connection();
+        bool isOpen() const { return m_db.isOpen(); }
+        QSqlDatabase database() const { return m_db; }
+    private:
+        QString m_connectionName;
+        QSqlDatabase m_db;
+    };
+
 private:
     explicit DatabaseHelper(QObject *parent = nullptr);
     ~DatabaseHelper();
@@ -43,8 +161,43 @@ private:
     DatabaseHelper(const DatabaseHelper&) = delete;
     DatabaseHelper& operator=(const DatabaseHelper&) = delete;
 
+    // 创建主库的表和索引，已存在时跳过
+    static bool createSchema(QSqlDatabase &db);
+
+    // 预编译写入tick的语句，table为带schema的表名
+    bool prepareInsertTick(const QString &table);
+
+    // 分区模式下切换到时间戳所属的写入分区
+    bool ensureWritePartition(qint64 timestamp);
+
+    // 读取同一交易日内最后保存的一笔tick的累计成交量，没有时返回false
+    bool loadLastVolume(const QString &stockCode, qint64 timestamp, qint64 &volume);
+
+    // 写出列式模式下各股票未写满的尾块，由定时器调用
+    void flushColumnarWriters();
+
+    // 在当前事务中更新tick所在的各周期K线
+    bool upsertBars(const QString &stockCode, double price, qint64 volume, qint64 timestamp);
+
+    // 从物化表读取K线，周期为物化周期的整数倍时在内存中合并
+    BarSeries loadMaterializedBars(const QString &stockCode, int intervalSecs, int baseIntervalSecs,
+                                   const QDateTime &startTime, const QDateTime &endTime);
+
+    // 在工作线程中重建单只股票的K线
+    static bool rebuildBarsForSymbol(const QString &stockCode);
+
     QSqlDatabase m_db;
     bool m_initialized;
+    bool m_needsBarRebuild;
+    QString m_dbPath;
+    StorageMode m_storageMode;
+    int m_compressAfterDays;        // 分区结束多少天后压缩，小于0表示不压缩
+    QString m_currentPartition;     // 作为cur挂载的写入分区
+    QSqlQuery m_insertTickQuery;
+    QSqlQuery m_upsertBarQuery;
+    QHash<QString, qint64> m_lastVolumes;  // 每只股票最近一次的日内累计成交量
+    QHash<QString, ColumnarTickStore::Writer> m_columnarWriters;  // 列式模式下每只股票的写入器
+    QTimer *m_columnarFlushTimer;   // 定时写出尾块
 };
 
 #endif // DATABASEHELPER_H
@@ -0,0 +1,79 @@
+#ifndef HISTORYLOADER_H
+#define HISTORYLOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QAtomicInt>
+
+/**
+ * @brief 一只股票的价格序列，时间为秒，与图表数据格式一致
+ */
+struct TickSeries
+{
+    QVector<double> keys;
+    QVector<double> values;
+
+    int size() const { return keys.size(); }
+    bool isEmpty() const { return keys.isEmpty(); }
+};
+
+/**
+ * @brief 启动时批量预加载所有自选股的近期历史
+ *
+ * 把时间窗口切成若干段，每段在独立的线程和数据库连接上沿时间索引倒序扫描一次，
+ * 一次取回所有股票的数据，分区模式下各段只挂载自己时间范围内的分区。
+ * 超出时间预算时停止扫描，已取回的是每段中最新的数据。
+ */
+class HistoryLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HistoryLoader(QObject *parent = nullptr);
+
+    // 预加载最近多长时间的数据
+    void setWindow(qint64 windowMs) { m_windowMs = windowMs; }
+    // 每只股票最多保留的点数
+    void setMaxPoints(int maxPoints) { m_maxPoints = maxPoints; }
+    // 加载的时间预算，超出后返回已取回的部分
+    void setTimeBudget(int budgetMs) { m_budgetMs = budgetMs; }
+
+    /**
+     * @brief 并行加载并等待完成或超出预算，进度通过progress信号在调用线程中报告
+     * @return 股票代码到价格序列的映射，按时间升序
+     */
+    QHash<QString, TickSeries> load(const QStringList &stockCodes);
+
+    // 上一次加载是否在预算内完成
+    bool isComplete() const { return m_complete; }
+    // 上一次加载读取的行数
+    qint64 rowCount() const { return m_rowCount; }
+
+signals:
+    void progress(int finished, int total);
+
+private:
+    struct Slice {
+        int index = 0;
+        qint64 fromMs = 0;              // 含
+        qint64 toMs = 0;                // 不含
+        QStringList stockCodes;         // 列式模式下按股票分段
+        QHash<QString, TickSeries> series;
+        qint64 rows = 0;
+    };
+
+    static void scanSlice(Slice &slice, const QSet<QString> &codes, int maxPoints, const QAtomicInt &cancel);
+    static void readColumnarSlice(Slice &slice, int maxPoints, const QAtomicInt &cancel);
+
+    qint64 m_windowMs;
+    int m_maxPoints;
+    int m_budgetMs;
+    bool m_complete;
+    qint64 m_rowCount;
+};
+
+#endif // HISTORYLOADER_H
@@ -3,7 +3,7 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QTableWidget>
+#include <QTableView>
 #include <QTimer>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
@@ -13,17 +13,32 @@
 #include <QMouseEvent>
 #include <QPoint>
 #include <QButtonGroup>
-#include <QReadWriteLock>
+#include <QThreadPool>
+
+#include "historyloader.h"
+#include "timeseriesstore.h"
+#include "slidingextremes.h"
+#include "minmaxpyramid.h"
 
 // 前向声明 QCustomPlot，避免包含整个头文件
 class QCustomPlot;
 class ThemeManager;
+class RetentionManager;
+class RenderScheduler;
+class CandleChart;
+class ChartGrid;
+class ChartCrosshair;
+class SparklineDelegate;
+class QuoteTableModel;
 
 QT_BEGIN_NAMESPACE
 class QVBoxLayout;
 class QHBoxLayout;
 class QPushButton;
 class QLabel;
+class QComboBox;
+class QStackedWidget;
+class QLineEdit;
 QT_END_NAMESPACE
 
 class MainWindow : public QMainWindow
@@ -38,16 +53,37 @@ private slots:
     void historyData();
     void refreshData();
     void onNetworkReplyFinished(QNetworkReply* reply);
+    void onTableClicked(const QModelIndex &index);
+    void onRenderFrame(bool chartDirty, const QList<int> &rows);
+    void onChartRangeChanged();
+    void onChartModeChanged(int index);
+    void onGridToggled(bool checked);
+    void onFilterChanged(const QString &text);
     void onMinimizeButtonClicked();
     void onMaximizeButtonClicked();
     void onCloseButtonClicked();
     void toggleTheme();
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private:
     void setupUI();
+    void loadWatchlist();
     void initializeTable();
+    void populateTable();
     void initializeChart();
     void updateChart();
+    void showChart(const QString &code);
+    void updateVisibleRows();
+
+    // 分阶段启动：首次绘制后依次初始化数据库、预加载历史、开始刷新行情
+    void startDeferredInit();
+    void onSchemaReady(bool success);
+    void onDatabaseReady();
+    void warmUpHistory();
+    void applyHistory(const QHash<QString, TickSeries> &history, bool complete);
+    void startRefreshing();
 
     // 鼠标事件处理
     void mousePressEvent(QMouseEvent *event) override;
@@ -65,11 +101,20 @@ private:
     QVBoxLayout *m_mainLayout;
     QHBoxLayout *m_controlLayout; // 控制按钮布局
     QHBoxLayout *m_titleLayout;   // 标题栏布局
-    QTableWidget *m_tableWidget;
+    QTableView *m_tableView;
+    QuoteTableModel *m_quoteModel; // 行情表格的数据
+    SparklineDelegate *m_sparklineDelegate; // 表格走势列
     QCustomPlot *m_chartWidget;
+    CandleChart *m_candleChart;   // 与分时图共用同一个图表
+    ChartCrosshair *m_crosshair;  // 图表十字光标
+    QStackedWidget *m_chartStack; // 单图和多图切换
+    ChartGrid *m_chartGrid;       // 多只股票的分时小图
     QButtonGroup *m_groupBtn;
     QPushButton *m_historyButton;
     QPushButton *m_refreshButton;
+    QComboBox *m_chartModeBox;    // 分时/K线周期切换
+    QPushButton *m_gridButton;    // 多图开关
+    QLineEdit *m_filterEdit;      // 表格筛选条件
     QLabel *m_statusLabel;
     QLabel *m_titleLabel;         // 标题标签
     QPushButton *m_minimizeButton; // 最小化按钮
@@ -79,6 +124,13 @@ private:
     // 网络和数据
     QNetworkAccessManager *m_networkManager;
     QTimer *m_refreshTimer;
+    RetentionManager *m_retentionManager;
+    RenderScheduler *m_renderScheduler;   // 合并表格和图表的刷新
+    QThreadPool m_startupPool;    // 启动阶段的后台任务
+
+    // 启动阶段
+    bool m_firstPaintDone;
+    bool m_firstDataReceived;
 
     // 示例股票代码列表
     QStringList m_stockCodes;
@@ -92,19 +144,20 @@ private:
     bool m_isDarkTheme;
     ThemeManager* m_themeManager;
 
-    class PrivateDatas {
-    public:
-        PrivateDatas();
-        QReadWriteLock lock;
-        QVector<double> timestamps;
-        QVector<double> prices;
-        void Update(double, double);
-        bool HasTimestamp(double);
-    private:
-        const int maxSize = 150;
-    };
-    friend class PrivateDatas;
-    PrivateDatas m_datas;
+    // 各股票的价格序列，容量可在自选股列表中按股票配置
+    TimeSeriesStore m_seriesStore;
+    QString m_chartCode;          // 图表当前显示的股票
+
+    // 图表增量更新
+    QString m_plottedCode;        // 图表中已绘制的股票
+    SlidingExtremes m_priceExtremes;
+    bool m_fullChartUpdate;       // 每次整体重设数据并全部重绘，用于对比耗时
+
+    // 长时间范围抽稀
+    MinMaxPyramid m_chartPyramid;
+    bool m_lodActive;             // 图表中是抽稀后的数据
+    bool m_lodDirty;              // 可见范围变化，需要重新抽稀
+    bool m_updatingChart;         // 程序调整坐标范围时不触发重新抽稀
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,65 @@
+#ifndef MINMAXPYRAMID_H
+#define MINMAXPYRAMID_H
+
+#include <QtGlobal>
+#include <QVector>
+
+/**
+ * @brief 多分辨率最小/最大值金字塔，用于长时间范围的图表抽稀
+ *
+ * 第0层是原始点，第L层每个桶汇总 8^L 个原始点的最小值和最大值及其出现时间。
+ * 桶按原始点的累计序号对齐，追加只更新各层末尾的桶，O(层数)。
+ * query()为可见范围挑选桶数不超过像素宽度的最细一层，每个桶输出最小、最大两个点，
+ * 输出点数只与宽度有关，与数据量无关。
+ */
+class MinMaxPyramid
+{
+public:
+    // 每层的合并倍数，取2的幂
+    static const int FanoutBits = 3;
+    static const int Fanout = 1 << FanoutBits;
+
+    void clear();
+
+    // 追加一个点，时间必须递增
+    void append(double key, double value);
+    // 丢弃最旧的count个点
+    void removeFirst(int count);
+
+    int size() const { return m_keys.size(); }
+    bool isEmpty() const { return m_keys.isEmpty(); }
+    double key(int index) const { return m_keys.at(index); }
+    double firstKey() const { return m_keys.first(); }
+    double lastKey() const { return m_keys.last(); }
+    int levelCount() const { return m_levels.size() + 1; }
+
+    /**
+     * @brief 取[lower, upper]范围内抽稀后的点，两端各多取一个点使曲线连到边界外
+     * @param maxBuckets 桶数上限，一般取绘图区宽度（像素）
+     * @return 使用的层，0表示原始点
+     */
+    int query(double lower, double upper, int maxBuckets,
+              QVector<double> &keys, QVector<double> &values) const;
+
+private:
+    struct Bucket {
+        double minKey;
+        double minValue;
+        double maxKey;
+        double maxValue;
+    };
+
+    // 第level层（从1开始）第一个桶的累计序号
+    qint64 levelBase(int level) const { return m_first >> (FanoutBits * level); }
+    void addToLevel(int level, qint64 bucketIndex, const Bucket &bucket);
+    void addLevel();
+    Bucket rebuildBucket(int level, qint64 bucketIndex) const;
+    static void merge(Bucket &target, const Bucket &source);
+
+    QVector<double> m_keys;              // 原始点，下标0对应累计序号m_first
+    QVector<double> m_values;
+    QVector<QVector<Bucket>> m_levels;   // m_levels[i] 为第i+1层
+    qint64 m_first = 0;                  // 已丢弃的点数
+};
+
+#endif // MINMAXPYRAMID_H
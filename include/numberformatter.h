@@ -0,0 +1,33 @@
+#ifndef NUMBERFORMATTER_H
+#define NUMBERFORMATTER_H
+
+#include <QString>
+#include <QChar>
+
+/**
+ * @brief 定点小数和整数的快速格式化
+ *
+ * 按小数位数放大后四舍五入取整，逐位写入调用方提供的缓冲区，不查询区域设置，也不分配内存。
+ * 对行情中的价格与QString::number(value, 'f', decimals)结果相同；二进制表示恰好落在舍入边界附近的值
+ * （如2.675）可能在最后一位进1，接近0的负数不带负号。超出64位整数范围或不是有限值时按科学计数法输出。
+ */
+class NumberFormatter
+{
+public:
+    enum {
+        MaxDecimals = 8,
+        BufferSize = 32,    // 缓冲区至少需要的字符数
+    };
+
+    // 写入buffer开头，返回字符数
+    static int formatFixed(double value, int decimals, QChar *buffer);
+    static int formatInteger(qint64 value, QChar *buffer);
+
+    static QString fixed(double value, int decimals);
+    static QString integer(qint64 value);
+
+    // 与QString::arg和QString::number对比count次格式化的耗时，输出到日志
+    static int benchmark(int count);
+};
+
+#endif // NUMBERFORMATTER_H
@@ -0,0 +1,178 @@
+#ifndef QUOTETABLEMODEL_H
+#define QUOTETABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QModelIndexList>
+#include <QElapsedTimer>
+#include <QBrush>
+#include <QColor>
+
+class QTimer;
+
+/**
+ * @brief 行情表格的数据模型
+ *
+ * 每个字段按列存放在连续数组中，行情更新只改写数值，不创建单元格对象。
+ * 显示文字在data()中按需格式化并按单元格缓存，值不变时重绘不再格式化；
+ * 视图只对可见的单元格调用data()，行数到上万时滚动的开销也只与可见行数有关。
+ * setQuote()只记录哪些列有变化，commitRow()再对变化的列发出dataChanged。
+ * 视口外的行只更新数值，不记录变化也不发信号，滚动进入视口时视图会重新读取整行。
+ *
+ * 排序和筛选不复制数据，只维护视图行到序号（股票在自选股列表中的位置）的排列。
+ * 行情更新使排序键或筛选结果变化时只记下该行，applyPendingMoves()每帧把这些行
+ * 逐个二分定位后用beginMoveRows()移到新位置，其余行保持不动。除data()等视图接口外，行号参数均为序号。
+ *
+ * 价格变化时价格、涨跌额、涨跌幅三格的背景闪烁后在FlashMs内淡出。每行只记录闪烁开始时间和方向，
+ * 由一个定时器统一推进，背景色取自切换主题时预先生成的各级颜色。
+ */
+class QuoteTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        CodeColumn,
+        NameColumn,
+        PriceColumn,
+        ChangeColumn,
+        ChangePercentColumn,
+        PrevCloseColumn,
+        OpenColumn,
+        VolumeColumn,
+        OuterDiscColumn,
+        InnerDiscColumn,
+        TimeColumn,
+        TrendColumn,
+        ColumnCount
+    };
+
+    // 带前缀的完整股票代码，走势列的委托据此读取价格序列
+    static const int StockCodeRole = Qt::UserRole + 1;
+
+    enum {
+        FlashMs = 500,          // 闪烁淡出时间
+        FlashLevels = 16,       // 淡出过程的颜色级数
+        FlashIntervalMs = 33,   // 淡出动画的刷新间隔
+    };
+
+    explicit QuoteTableModel(QObject *parent = nullptr);
+
+    void setStockCodes(const QStringList &stockCodes);
+    QString stockCode(int row) const { return m_codes.at(row); }
+    // 找不到时返回-1
+    int rowOf(const QString &stockCode) const { return m_rows.value(stockCode, -1); }
+
+    /**
+     * @brief 写入一行行情，不通知视图
+     * @param parts HttpHelper::parseSinaData()返回的字段
+     * @return 该行需要在下一帧commitRow()，或排序位置、筛选结果可能变化
+     */
+    bool setQuote(int row, const QStringList &parts);
+
+    // 对setQuote()以来有变化的列发出dataChanged
+    void commitRow(int row);
+
+    // 把排序键或筛选结果有变化的行移到新位置，按帧调用
+    void applyPendingMoves();
+
+    // column为-1时按自选股列表的顺序
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+    int sortColumn() const { return m_sortColumn; }
+
+    // 代码或名称包含text的行，空字符串表示不筛选
+    void setTextFilter(const QString &text);
+    // 数值列在[min, max]内的行，column为-1表示不筛选
+    void setRangeFilter(int column, double min, double max);
+
+    // 涨跌颜色随主题变化
+    void setDarkTheme(bool dark);
+
+    // 视口内的视图行范围，由视图在滚动和改变大小时更新
+    void setVisibleRows(int first, int last);
+    bool isRowVisible(int row) const
+    {
+        const int position = m_position.at(row);
+        return position >= m_firstVisible && position <= m_lastVisible;
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    // 按涨跌幅排序的rows行表格，每帧更新十分之一的行，输出applyPendingMoves()每帧的耗时
+    static int benchmark(int rows, int frames = 300);
+
+private slots:
+    void onFlashTimer();
+
+private:
+    void startFlash(int row, bool up);
+    // 按主题生成涨跌颜色和各级闪烁背景
+    void buildPalette();
+    double numericValue(int row, int column) const;
+    QString formatCell(int row, int column) const;
+    bool lessThan(int left, int right) const;
+    bool acceptsRow(int row) const;
+    // 按当前筛选和排序重建排列
+    void rebuildOrder();
+    // 行在m_order中按排序应插入的下标，跳过等待重新定位的行
+    int insertPosition(int row) const;
+    void updatePositions(int first, int last);
+    QVector<int> persistentRows(const QModelIndexList &indexes) const;
+    void restorePersistent(const QModelIndexList &indexes, const QVector<int> &rows);
+
+    QStringList m_codes;
+    QHash<QString, int> m_rows;
+    bool m_darkTheme;
+    int m_firstVisible;
+    int m_lastVisible;
+
+    // 按列存放的行情，m_time为0表示该行还没有数据
+    QVector<QString> m_names;
+    QVector<double> m_price;
+    QVector<double> m_change;
+    QVector<double> m_changePercent;
+    QVector<double> m_prevClose;
+    QVector<double> m_open;
+    QVector<qint64> m_volume;
+    QVector<qint64> m_outerDisc;
+    QVector<qint64> m_innerDisc;
+    QVector<qint64> m_time;
+
+    // 每行尚未通知视图的变化列，按位记录
+    QVector<quint32> m_changedColumns;
+
+    // 格式化后的文字，按 序号*ColumnCount+列 存放，空值表示需要重新格式化
+    mutable QVector<QString> m_textCache;
+
+    // 排序和筛选
+    QVector<int> m_order;          // 视图行 -> 序号
+    QVector<int> m_position;       // 序号 -> 视图行，被筛掉的为-1
+    int m_sortColumn;
+    Qt::SortOrder m_sortOrder;
+    QString m_textFilter;
+    int m_rangeColumn;
+    double m_rangeMin;
+    double m_rangeMax;
+    QVector<int> m_pendingRows;    // 等待重新定位的序号
+    QVector<bool> m_pending;
+
+    // 闪烁状态，m_flashStart为0表示不在闪烁
+    QVector<qint64> m_flashStart;
+    QVector<qint8> m_flashUp;
+    QVector<int> m_flashRows;      // 正在闪烁的序号
+    QTimer *m_flashTimer;
+    QElapsedTimer m_clock;
+
+    // 当前主题的颜色
+    QColor m_upColor;
+    QColor m_downColor;
+    QBrush m_flashUpBrushes[FlashLevels];
+    QBrush m_flashDownBrushes[FlashLevels];
+};
+
+#endif // QUOTETABLEMODEL_H
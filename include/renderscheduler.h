@@ -0,0 +1,64 @@
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <QObject>
+#include <QSet>
+#include <QList>
+#include <QElapsedTimer>
+
+class QTimer;
+
+/**
+ * @brief 合并界面刷新的调度器
+ *
+ * 行情回包只标记图表或表格行为脏，调度器用一个单次定时器在下一帧统一刷新，
+ * 两次刷新的间隔不小于 1000/maxFps 毫秒。同一帧内对同一目标的多次标记只刷新一次，
+ * 被合并掉的次数定期输出到日志。只在主线程中使用。
+ */
+class RenderScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RenderScheduler(QObject *parent = nullptr);
+
+    // 每秒最多刷新的帧数，默认60
+    void setMaxFps(int fps);
+    int maxFps() const { return m_maxFps; }
+
+    void markChartDirty();
+    void markRowDirty(int row);
+
+    // 累计的标记次数和实际刷新的目标数
+    qint64 requestCount() const { return m_requests; }
+    qint64 flushedCount() const { return m_flushed; }
+    qint64 frameCount() const { return m_frames; }
+
+signals:
+    /**
+     * @brief 一帧的刷新内容
+     * @param chartDirty 图表是否需要更新
+     * @param rows 需要更新的表格行，按行号升序
+     */
+    void frame(bool chartDirty, const QList<int> &rows);
+
+private slots:
+    void flush();
+
+private:
+    void schedule();
+
+    QTimer *m_timer;
+    QElapsedTimer m_sinceFlush;
+    QElapsedTimer m_sinceReport;
+    int m_maxFps;
+    bool m_chartDirty;
+    QSet<int> m_dirtyRows;
+
+    // 合并统计
+    qint64 m_requests;
+    qint64 m_flushed;
+    qint64 m_frames;
+};
+
+#endif // RENDERSCHEDULER_H
@@ -0,0 +1,101 @@
+#ifndef RETENTIONMANAGER_H
+#define RETENTIONMANAGER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QMap>
+#include <QThreadPool>
+
+class QTimer;
+
+/**
+ * @brief 一组股票的数据保留策略
+ */
+struct RetentionPolicy
+{
+    QString group;           // 分组名称
+    QStringList prefixes;    // 匹配的股票代码前缀，为空表示默认分组
+    int rawDays = 30;        // 原始tick保留天数，0表示永久保留
+    QMap<int, int> barDays;  // 各周期K线保留天数（周期秒数 -> 天数），0或缺省表示永久保留
+    bool archive = true;     // 过期tick移入按月归档库，否则直接删除
+};
+
+/**
+ * @brief 数据保留引擎
+ *
+ * 在后台线程中增量清理 ticker_data.db：超过保留期的原始tick先补齐K线，
+ * 再移入归档库或删除；超过保留期的K线直接删除。每一步只处理一只股票的一天数据，
+ * 写事务很短，配合WAL模式不会阻塞行情写入。
+ */
+class RetentionManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RetentionManager(QObject *parent = nullptr);
+    ~RetentionManager();
+
+    /**
+     * @brief 从ini文件加载分组策略，文件不存在时写入默认策略
+     * @param fileName 策略文件路径
+     * @return 加载成功返回true
+     */
+    bool loadPolicies(const QString &fileName);
+
+    /**
+     * @brief 直接设置分组策略
+     */
+    void setPolicies(const QList<RetentionPolicy> &policies);
+    QList<RetentionPolicy> policies() const { return m_policies; }
+
+    /**
+     * @brief 按最长前缀匹配股票所属的策略，未匹配时返回默认策略
+     */
+    static const RetentionPolicy &matchPolicy(const QList<RetentionPolicy> &policies,
+                                              const QString &stockCode);
+
+    /**
+     * @brief 开始周期性清理
+     * @param idleIntervalMs 没有积压时两次清理之间的间隔
+     */
+    void start(int idleIntervalMs = 60000);
+    void stop();
+
+signals:
+    /**
+     * @brief 一轮清理完成
+     * @param compactedDays 本轮处理的（股票, 天）及分区数量
+     * @param removedTicks 本轮移出主库的tick数
+     * @param backlog 是否仍有待处理的过期数据
+     */
+    void stepFinished(int compactedDays, qint64 removedTicks, bool backlog);
+
+private slots:
+    void runStep();
+
+private:
+    struct StepState {
+        QStringList codes;       // 本轮遍历的股票代码，一轮结束后重新获取
+        int cursor = 0;          // 下一只待处理股票的位置
+        int compactedDays = 0;
+        qint64 removedTicks = 0;
+        bool backlog = false;
+    };
+
+    // 在工作线程中执行一轮清理，受时间预算限制
+    static void executeStep(const QList<RetentionPolicy> &policies, StepState &state, qint64 now);
+
+    void onStepFinished(const StepState &state);
+
+    QList<RetentionPolicy> m_policies;
+    QThreadPool m_pool;          // 单线程池，保证同一时间只有一轮清理
+    QTimer *m_timer;
+    StepState m_state;
+    int m_idleIntervalMs;
+    bool m_enabled;
+    bool m_running;
+};
+
+#endif // RETENTIONMANAGER_H
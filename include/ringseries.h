@@ -0,0 +1,141 @@
+#ifndef RINGSERIES_H
+#define RINGSERIES_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QAtomicInteger>
+
+/**
+ * @brief 定长环形时间序列，单生产者单消费者无锁
+ *
+ * 容量取不小于指定值的2的幂，写满后覆盖最旧的点，追加和淘汰都是O(1)。
+ * 时间必须单调递增，因此判断某个时间是否已存在只需与末尾比较。
+ *
+ * 生产者线程调用append()，消费者线程调用snapshot()等读取接口；两者在同一线程时同样适用。
+ * 写入位置在写完数据后以release语义发布，读取方先acquire再读数据；
+ * 拷贝期间被生产者覆盖的最旧的点会在拷贝后按写入位置剔除，读到的总是一段连续的有效数据。
+ */
+template <typename T>
+class RingSeries
+{
+public:
+    explicit RingSeries(int capacity = 256)
+    {
+        int size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_mask = size - 1;
+        m_keys.resize(size);
+        m_values.resize(size);
+    }
+
+    int capacity() const { return int(m_mask + 1); }
+
+    // 生产者：追加一个点，时间不大于末尾时返回false
+    bool append(double key, const T &value)
+    {
+        const quint64 head = m_head.loadRelaxed();
+        if (head > 0 && key <= m_keys.at(int((head - 1) & m_mask))) {
+            return false;
+        }
+
+        const int index = int(head & m_mask);
+        m_keys[index] = key;
+        m_values[index] = value;
+        m_head.storeRelease(head + 1);
+        return true;
+    }
+
+    // 当前点数
+    int size() const
+    {
+        return int(qMin<quint64>(m_head.loadAcquire(), quint64(capacity())));
+    }
+
+    bool isEmpty() const { return m_head.loadAcquire() == 0; }
+
+    // 末尾的时间，空序列返回0
+    double lastKey() const
+    {
+        const quint64 head = m_head.loadAcquire();
+        return head > 0 ? m_keys.at(int((head - 1) & m_mask)) : 0.0;
+    }
+
+    T lastValue() const
+    {
+        const quint64 head = m_head.loadAcquire();
+        return head > 0 ? m_values.at(int((head - 1) & m_mask)) : T();
+    }
+
+    // 时间单调递增，不大于末尾时间的点已写入或已淘汰
+    bool contains(double key) const
+    {
+        const quint64 head = m_head.loadAcquire();
+        return head > 0 && key <= m_keys.at(int((head - 1) & m_mask));
+    }
+
+    // 消费者：按时间顺序拷贝全部点，返回点数
+    int snapshot(QVector<double> &keys, QVector<T> &values) const
+    {
+        const quint64 head = m_head.loadAcquire();
+        const quint64 cap = quint64(capacity());
+        quint64 begin = head > cap ? head - cap : 0;
+
+        keys.resize(int(head - begin));
+        values.resize(int(head - begin));
+        for (quint64 i = begin; i < head; ++i) {
+            keys[int(i - begin)] = m_keys.at(int(i & m_mask));
+            values[int(i - begin)] = m_values.at(int(i & m_mask));
+        }
+
+        // 拷贝期间被覆盖的点从头部剔除
+        const quint64 after = m_head.loadAcquire();
+        if (after > cap && after - cap > begin) {
+            const int overwritten = int(qMin(after - cap - begin, head - begin));
+            keys.remove(0, overwritten);
+            values.remove(0, overwritten);
+        }
+        return keys.size();
+    }
+
+    // 消费者：只拷贝时间晚于after的点，用于增量更新，返回点数
+    int snapshotAfter(double after, QVector<double> &keys, QVector<T> &values) const
+    {
+        const quint64 head = m_head.loadAcquire();
+        const quint64 cap = quint64(capacity());
+        const quint64 oldest = head > cap ? head - cap : 0;
+
+        // 新点都在末尾，从末尾向前找到起点
+        quint64 begin = head;
+        while (begin > oldest && m_keys.at(int((begin - 1) & m_mask)) > after) {
+            --begin;
+        }
+
+        keys.resize(int(head - begin));
+        values.resize(int(head - begin));
+        for (quint64 i = begin; i < head; ++i) {
+            keys[int(i - begin)] = m_keys.at(int(i & m_mask));
+            values[int(i - begin)] = m_values.at(int(i & m_mask));
+        }
+
+        const quint64 now = m_head.loadAcquire();
+        if (now > cap && now - cap > begin) {
+            const int overwritten = int(qMin(now - cap - begin, head - begin));
+            keys.remove(0, overwritten);
+            values.remove(0, overwritten);
+        }
+        return keys.size();
+    }
+
+    // 只能在没有生产者写入时调用
+    void clear() { m_head.storeRelease(0); }
+
+private:
+    QVector<double> m_keys;
+    QVector<T> m_values;
+    quint64 m_mask = 0;
+    QAtomicInteger<quint64> m_head { 0 };   // 累计写入的点数，低位即写入位置
+};
+
+#endif // RINGSERIES_H
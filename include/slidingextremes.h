@@ -0,0 +1,70 @@
+#ifndef SLIDINGEXTREMES_H
+#define SLIDINGEXTREMES_H
+
+#include <QtGlobal>
+#include <deque>
+#include <utility>
+
+/**
+ * @brief 滑动窗口内的最小值和最大值
+ *
+ * 窗口为最近window个点，与环形序列的保留范围一致。
+ * 两个单调队列分别保存可能成为最小值、最大值的点，每个点最多入队出队一次，
+ * 追加的均摊开销为O(1)，查询为O(1)。
+ */
+class SlidingExtremes
+{
+public:
+    explicit SlidingExtremes(int window = 256) : m_window(window) {}
+
+    void setWindow(int window)
+    {
+        m_window = window;
+        evict();
+    }
+
+    void clear()
+    {
+        m_count = 0;
+        m_min.clear();
+        m_max.clear();
+    }
+
+    void append(double value)
+    {
+        while (!m_min.empty() && m_min.back().second >= value) {
+            m_min.pop_back();
+        }
+        while (!m_max.empty() && m_max.back().second <= value) {
+            m_max.pop_back();
+        }
+        m_min.emplace_back(m_count, value);
+        m_max.emplace_back(m_count, value);
+        ++m_count;
+        evict();
+    }
+
+    bool isEmpty() const { return m_min.empty(); }
+    double minimum() const { return m_min.front().second; }
+    double maximum() const { return m_max.front().second; }
+
+private:
+    // 丢弃已滑出窗口的点
+    void evict()
+    {
+        const qint64 oldest = m_count - m_window;
+        while (!m_min.empty() && m_min.front().first < oldest) {
+            m_min.pop_front();
+        }
+        while (!m_max.empty() && m_max.front().first < oldest) {
+            m_max.pop_front();
+        }
+    }
+
+    qint64 m_window;
+    qint64 m_count = 0;
+    std::deque<std::pair<qint64, double>> m_min;
+    std::deque<std::pair<qint64, double>> m_max;
+};
+
+#endif // SLIDINGEXTREMES_H
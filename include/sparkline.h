@@ -0,0 +1,32 @@
+#ifndef SPARKLINE_H
+#define SPARKLINE_H
+
+#include <QVector>
+#include <QPointF>
+#include <QRect>
+#include <QColor>
+
+/**
+ * @brief 小尺寸走势线的绘制辅助
+ *
+ * 多图墙和表格走势列共用：把价格序列映射到矩形内，每个像素列只保留最小、最大两个点，
+ * 点数只与宽度有关。
+ */
+class Sparkline
+{
+public:
+    /**
+     * @brief 生成折线顶点
+     * @param keys 时间，升序
+     * @param values 价格
+     * @param rect 绘制区域
+     * @param points 输出的顶点，调用方复用以避免分配
+     */
+    static void buildPath(const QVector<double> &keys, const QVector<double> &values,
+                          const QRect &rect, QVector<QPointF> &points);
+
+    // 按窗口内涨跌取颜色：涨为红色，跌为绿色
+    static QColor trendColor(double first, double last);
+};
+
+#endif // SPARKLINE_H
@@ -0,0 +1,43 @@
+#ifndef SPARKLINEDELEGATE_H
+#define SPARKLINEDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QHash>
+#include <QPixmap>
+#include <QVector>
+#include <QPointF>
+
+class TimeSeriesStore;
+
+/**
+ * @brief 表格走势列的委托
+ *
+ * 单元格通过QuoteTableModel::StockCodeRole提供股票代码，委托从内存价格序列画出走势线并缓存为QPixmap。
+ * 新点到达时调用invalidate()丢弃该股票的缓存，下次绘制该行时才重新生成，
+ * 不在屏幕上的行不产生任何绘制开销。
+ */
+class SparklineDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit SparklineDelegate(TimeSeriesStore *store, QObject *parent = nullptr);
+
+    // 该股票有新数据，丢弃缓存
+    void invalidate(const QString &stockCode);
+    void invalidateAll();
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option,
+               const QModelIndex &index) const override;
+
+private:
+    TimeSeriesStore *m_store;
+    mutable QHash<QString, QPixmap> m_cache;
+
+    // 复用的缓冲
+    mutable QVector<double> m_keys;
+    mutable QVector<double> m_values;
+    mutable QVector<QPointF> m_points;
+};
+
+#endif // SPARKLINEDELEGATE_H
@@ -0,0 +1,22 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QString>
+
+/**
+ * @brief 启动阶段计时
+ *
+ * main()开头调用start()，之后在各阶段完成处调用mark()，
+ * 同名阶段只记录第一次。report()按时间顺序输出各阶段的时间点和间隔。
+ * 只在主线程中使用。
+ */
+class StartupProfiler
+{
+public:
+    static void start();
+    static void mark(const QString &phase);
+    static qint64 elapsed();
+    static void report();
+};
+
+#endif // STARTUPPROFILER_H
@@ -4,11 +4,17 @@
 
 #include <QObject>
 #include <QColor>
+#include <QPen>
+#include <QBrush>
+#include <QPalette>
+#include <QPointer>
 #include <QApplication>
 #include <QFile>
 #include <QTextStream>
 #include <QDebug>
 
+class QCustomPlot;
+
 /**
  * @brief 主题管理器类，负责管理应用程序的主题切换
  */
@@ -26,6 +32,18 @@ public:
         Unkonw, // none
     };
 
+    /**
+     * @brief 预先生成的控件调色板和图表配色，画笔和画刷直接套用
+     */
+    struct Theme {
+        QPalette palette;         // 控件颜色
+        QBrush chartBackground;   // 图表背景
+        QColor chartText;         // 坐标轴文字
+        QPen axisPen;             // 坐标轴、刻度
+        QPen gridPen;             // 网格线
+        QPen linePen;             // 分时曲线
+    };
+
     /**
      * @brief 获取主题管理器单例实例
      * @return 主题管理器实例
@@ -57,6 +75,18 @@ public:
      */
     QColor getColor(const QString& colorName) const;
 
+    /**
+     * @brief 获取当前主题预先生成的样式
+     * @return 当前主题，未设置时为浅色主题
+     */
+    const Theme& theme() const { return m_currentTheme == Dark ? m_darkTheme : m_lightTheme; }
+
+    /**
+     * @brief 把当前主题的配色套用到图表上，不重绘
+     * @param plot 要设置的图表
+     */
+    void applyChartTheme(QCustomPlot* plot) const;
+
     /**
      * @brief 加载并应用样式表
      * @param fileName 样式表文件名
@@ -66,14 +96,26 @@ public:
 
     /**
      * @brief 应用当前主题样式
+     *
+     * 控件颜色来自预先生成的调色板，切换时只替换应用程序调色板，控件各自重绘。
+     * 样式表只在构造时设置一次，除尺寸外只给addStyledWidget()登记的几个控件画圆角和边框，
+     * 这几个控件的深色规则以自身的darkTheme属性区分，切换时只重新polish它们本身。
      */
     void applyCurrentTheme();
 
     /**
-     * @brief 更新特定控件的样式
-     * @param widget 要更新的控件
+     * @brief 登记由样式表按主题着色的控件
+     * @param widget 对象名与样式表中带darkTheme属性的规则对应的控件
+     */
+    void addStyledWidget(QWidget* widget);
+
+    /**
+     * @brief 对比切换主题的耗时，输出到日志
+     *
+     * 创建与主窗口相近的控件树，分别测量替换调色板和逐个重新polish全部控件，每种方式切换count次。
+     * 需要在QApplication创建之后调用。
      */
-    void updateWidgetStyle(QWidget* widget);
+    static int benchmark(int count);
 
 signals:
     /**
@@ -93,9 +135,18 @@ private:
      */
     void initializeColorMaps();
 
+    /**
+     * @brief 读取样式表并生成两套主题
+     */
+    void compileThemes();
+
     ThemeType m_currentTheme;  // 当前主题类型
     QMap<QString, QColor> m_lightColors;  // 浅色主题颜色映射
     QMap<QString, QColor> m_darkColors;    // 深色主题颜色映射
+    Theme m_lightTheme;                    // 预先生成的浅色主题
+    Theme m_darkTheme;                     // 预先生成的深色主题
+    QString m_styleSheet;                  // 包含两套主题的样式表
+    QList<QPointer<QWidget>> m_styledWidgets;  // 由样式表按主题着色的控件
 };
 
 #endif // THEME_MANAGER_H
@@ -0,0 +1,149 @@
+#ifndef TICKCODEC_H
+#define TICKCODEC_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include <QFile>
+#include <QDataStream>
+#include <QSqlDatabase>
+
+/**
+ * @brief 整数序列的分块压缩编码
+ *
+ * 先做差分（时间戳用二阶差分），再做zigzag映射，然后每128个值按块内最大位宽紧凑打包。
+ * 相邻tick的价格只差几分钱、时间间隔几乎固定，大部分块只需几位；不变的列位宽为0，不占数据。
+ * 解码是定长位宽的解包、zigzag还原和前缀和三个无分支的循环，编译器可以自动向量化。
+ */
+class TickCodec
+{
+public:
+    enum {
+        BlockSize = 128,    // 每个打包块的值个数
+        PriceScale = 1000,  // 价格定点倍数，保留3位小数
+    };
+
+    /**
+     * @brief 编码一列整数
+     * @param deltaOrder 差分阶数：0不差分，1一阶差分，2二阶差分
+     */
+    static QByteArray encode(const QVector<qint64> &values, int deltaOrder);
+
+    /**
+     * @brief 解码一列整数，count为编码时的值个数
+     */
+    static bool decode(const QByteArray &data, int count, int deltaOrder, QVector<qint64> &values);
+
+    static qint64 toFixed(double price) { return qRound64(price * PriceScale); }
+    static double fromFixed(qint64 value) { return value / double(PriceScale); }
+};
+
+/**
+ * @brief 一只股票按时间排序的tick，按列存放
+ */
+struct TickRows
+{
+    QString stockCode;
+    QString name;
+    QVector<qint64> timestamps;
+    QVector<qint64> prices;       // 定点价格
+    QVector<qint64> prevCloses;   // 定点价格
+    QVector<qint64> openPrices;   // 定点价格
+    QVector<qint64> volumes;
+    QVector<qint64> outerDiscs;
+    QVector<qint64> innerDiscs;
+
+    int size() const { return timestamps.size(); }
+    // 第一笔时间不早于/晚于timestamp的下标，二分查找
+    int lowerBound(qint64 timestamp) const;
+    int upperBound(qint64 timestamp) const;
+
+    // 按时间顺序遍历[fromMs, toMs]内的tick，visitor参数为(时间戳, 价格, 成交量)
+    template <typename Visitor>
+    void forEachTick(qint64 fromMs, qint64 toMs, Visitor &&visitor) const
+    {
+        const int last = upperBound(toMs);
+        for (int i = lowerBound(fromMs); i < last; ++i) {
+            visitor(timestamps.at(i), TickCodec::fromFixed(prices.at(i)), volumes.at(i));
+        }
+    }
+
+    // 涨跌额和涨跌幅未保存，按价格和昨收推算
+    double change(int i) const;
+    double changePercent(int i) const;
+    void clear();
+    void append(qint64 timestamp, double price, double prevClose, double openPrice,
+                qint64 volume, qint64 outerDisc, qint64 innerDisc);
+};
+
+/**
+ * @brief 压缩的tick归档文件（.tkz），用于冷分区和导出
+ *
+ * 文件由若干股票段组成，每段保存股票代码、名称和各列的压缩数据。
+ * 涨跌额和涨跌幅由价格和昨收推算，不单独保存。
+ */
+class TickArchive
+{
+public:
+    /**
+     * @brief 顺序写入股票段
+     */
+    class Writer {
+    public:
+        explicit Writer(const QString &path);
+        bool isOpen() const { return m_file.isOpen(); }
+        bool add(const TickRows &rows);
+        // 写入结束标记并关闭文件
+        bool finish();
+        qint64 rowCount() const { return m_rowCount; }
+    private:
+        QFile m_file;
+        QDataStream m_stream;
+        qint64 m_rowCount = 0;
+    };
+
+    /**
+     * @brief 顺序读取股票段
+     */
+    class Reader {
+    public:
+        explicit Reader(const QString &path);
+        bool isOpen() const { return m_valid; }
+        // 读取下一只股票，没有更多数据时返回false
+        bool next(TickRows &rows);
+        // 只读取下一只股票的代码，之后须调用read()解码或skip()跳过该股票的数据
+        bool nextCode(QString &stockCode);
+        bool read(TickRows &rows);
+        bool skip();
+    private:
+        QFile m_file;
+        QDataStream m_stream;
+        bool m_valid = false;
+        QString m_stockCode;
+        QString m_name;
+        qint32 m_count = 0;
+    };
+
+    /**
+     * @brief 从tick表读取一只股票的数据并追加到rows
+     */
+    static bool readRows(QSqlDatabase &db, const QString &table, const QString &stockCode, TickRows &rows);
+
+    /**
+     * @brief 从归档文件读取一只股票的数据并追加到rows，其他股票的数据跳过不解码
+     */
+    static bool readRows(const QString &path, const QString &stockCode, TickRows &rows);
+
+    /**
+     * @brief 归档文件中的股票代码
+     */
+    static QStringList stockCodes(const QString &path);
+
+    /**
+     * @brief 把tick表整体编码为归档文件
+     */
+    static bool encodeTable(QSqlDatabase &db, const QString &table, const QString &path);
+};
+
+#endif // TICKCODEC_H
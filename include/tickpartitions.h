@@ -0,0 +1,97 @@
+#ifndef TICKPARTITIONS_H
+#define TICKPARTITIONS_H
+
+#include <QString>
+#include <QList>
+#include <QSqlDatabase>
+
+/**
+ * @brief 按交易日（或周）分区的tick存储
+ *
+ * 每个分区是数据目录 partitions/ 下的一个独立SQLite文件，主库的 partitions 表
+ * 记录各分区的时间范围，查询时只挂载与时间范围重叠的分区。
+ * 不再写入的旧分区会被封存（整理为只读的紧凑文件），超过指定天数后压缩保存。
+ */
+class TickPartitions
+{
+public:
+    /**
+     * @brief 分区粒度
+     */
+    enum Granularity {
+        Daily,   // 每个交易日一个文件
+        Weekly,  // 每周（周一起）一个文件
+    };
+
+    /**
+     * @brief 分区目录项
+     */
+    struct Partition {
+        QString key;            // 分区键，日分区为yyyyMMdd，周分区为w+周一日期
+        qint64 startTime = 0;   // 分区起始时间（毫秒，含）
+        qint64 endTime = 0;     // 分区结束时间（毫秒，不含）
+        qint64 rowCount = 0;    // 封存时统计的行数
+        bool sealed = false;    // 已封存，不再写入
+        bool compressed = false;// 已压缩
+    };
+
+    /**
+     * @brief 在主库中创建分区目录表
+     */
+    static bool ensureCatalog(QSqlDatabase &db);
+
+    /**
+     * @brief 计算时间戳所属的分区
+     */
+    static Partition partitionFor(qint64 timestamp, Granularity granularity);
+
+    /**
+     * @brief 登记分区（已存在时读取目录中的状态）
+     */
+    static bool registerPartition(QSqlDatabase &db, Partition &partition);
+
+    /**
+     * @brief 查询与[fromMs, toMs]重叠的分区
+     * @param newestFirst 为true时按时间倒序返回
+     */
+    static QList<Partition> overlapping(QSqlDatabase &db, qint64 fromMs, qint64 toMs, bool newestFirst);
+
+    /**
+     * @brief 按时间顺序返回结束时间不晚于cutoff的已封存分区，最多limit个
+     */
+    static QList<Partition> endedBefore(QSqlDatabase &db, qint64 cutoff, int limit);
+
+    /**
+     * @brief 分区文件路径
+     */
+    static QString filePath(const QString &key);
+
+    /**
+     * @brief 可挂载的分区文件路径；已压缩或文件不存在时返回空
+     */
+    static QString openablePath(const Partition &partition);
+
+    /**
+     * @brief 已压缩分区的归档文件路径，查询直接读取归档；未压缩或文件不存在时返回空
+     */
+    static QString archivePath(const Partition &partition);
+
+    /**
+     * @brief 封存除当前写入分区外所有已结束的分区，并压缩超过指定天数的分区
+     * @param currentKey 当前写入分区
+     * @param compressAfterDays 分区结束多少天后压缩，小于0表示不压缩
+     */
+    static void sealPartitions(const QString &currentKey, int compressAfterDays);
+
+    /**
+     * @brief 把分区中的tick补齐为K线后移入归档目录或删除，并从目录中移除
+     */
+    static bool retirePartition(QSqlDatabase &db, const Partition &partition, bool archive);
+
+private:
+    static QString directory();
+    static QString compressedPath(const QString &key);
+    static bool compressFile(const QString &source, const QString &target);
+};
+
+#endif // TICKPARTITIONS_H
@@ -0,0 +1,83 @@
+#ifndef TIMESERIESSTORE_H
+#define TIMESERIESSTORE_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+
+#include "ringseries.h"
+
+/**
+ * @brief 所有自选股的内存价格序列
+ *
+ * 每只股票一个定长环形序列，时间和价格分两列连续存放，切换图表时无需查询数据库。
+ * 总内存超出上限时，按用户最近查看的时间淘汰当前未显示的股票，行情追加和绘制不算查看；
+ * 一次淘汰到上限的90%，避免每个新点都触发淘汰。被淘汰的股票不再接收新点，
+ * 直到再次查看或显式ensure()。只在主线程中使用。
+ */
+class TimeSeriesStore
+{
+public:
+    typedef RingSeries<double> Series;
+
+    explicit TimeSeriesStore(int defaultCapacity = 256);
+
+    // 未单独配置的股票保留的点数
+    void setDefaultCapacity(int capacity) { m_defaultCapacity = capacity; }
+    // 单只股票保留的点数，在序列创建前设置才生效
+    void setCapacity(const QString &stockCode, int capacity);
+    // 总内存上限（字节），0表示不限制
+    void setMemoryLimit(qint64 bytes);
+    qint64 memoryLimit() const { return m_memoryLimit; }
+
+    // 当前显示的股票，不会被淘汰；记为一次查看
+    void setActive(const QString &stockCode);
+    QString active() const { return m_active; }
+    // 股票的图表被用户查看，刷新最近使用时间，已被淘汰的重新接收新点
+    void touch(const QString &stockCode);
+
+    /**
+     * @brief 追加一个点，序列不存在时创建，已被淘汰的股票忽略
+     * @return 时间不晚于序列末尾或已被淘汰时返回false
+     */
+    bool append(const QString &stockCode, double key, double value);
+
+    // 取序列，不存在时返回nullptr；不影响淘汰顺序，可在绘制时调用
+    Series *series(const QString &stockCode) const;
+    // 取序列，不存在时创建
+    Series *ensure(const QString &stockCode);
+    bool contains(const QString &stockCode) const { return m_entries.contains(stockCode); }
+    QStringList stockCodes() const { return m_entries.keys(); }
+
+    // 单只股票占用的内存（字节），不存在时返回0
+    qint64 memoryUsage(const QString &stockCode) const;
+    // 全部序列占用的内存（字节）
+    qint64 memoryUsage() const { return m_memoryUsage; }
+    // 累计淘汰的序列数
+    int evictedCount() const { return m_evictedCount; }
+
+    // 指定容量的序列占用的内存
+    static qint64 bytesFor(int capacity);
+
+private:
+    struct Entry {
+        QSharedPointer<Series> series;
+        quint64 lastUsed = 0;
+    };
+
+    void evictIfNeeded();
+
+    QHash<QString, Entry> m_entries;
+    QHash<QString, int> m_capacity;
+    QSet<QString> m_evicted;       // 已淘汰、暂不接收新点的股票
+    QString m_active;
+    int m_defaultCapacity;
+    qint64 m_memoryLimit;
+    qint64 m_memoryUsage;
+    quint64 m_clock;
+    int m_evictedCount;
+};
+
+#endif // TIMESERIESSTORE_H
@@ -0,0 +1,118 @@
+#include "barbuilder.h"
+#include <QDateTime>
+
+void BarSeries::reserve(int count)
+{
+    keys.reserve(count);
+    open.reserve(count);
+    high.reserve(count);
+    low.reserve(count);
+    close.reserve(count);
+    volume.reserve(count);
+}
+
+void BarSeries::clear()
+{
+    keys.clear();
+    open.clear();
+    high.clear();
+    low.clear();
+    close.clear();
+    volume.clear();
+}
+
+void BarSeries::append(const StockBar &bar)
+{
+    keys.append(bar.time / 1000.0);
+    open.append(bar.open);
+    high.append(bar.high);
+    low.append(bar.low);
+    close.append(bar.close);
+    volume.append(static_cast<double>(bar.volume));
+}
+
+BarBuilder::BarBuilder(qint64 intervalMs, qint64 utcOffsetMs)
+    : m_intervalMs(qMax<qint64>(intervalMs, 1))
+    , m_utcOffsetMs(utcOffsetMs)
+    , m_lastCumulativeVolume(-1)
+    , m_hasBar(false)
+    , m_hasClosedBar(false)
+{
+}
+
+BarBuilder::TickResult BarBuilder::addTick(qint64 timestamp, double price, qint64 cumulativeVolume)
+{
+    qint64 start = bucketStart(timestamp);
+    if (m_hasBar && start < m_current.time) {
+        return Ignored;
+    }
+
+    // 累计量差值即为这笔tick的成交量，首笔数据没有基准，记为0
+    qint64 delta = 0;
+    if (m_lastCumulativeVolume >= 0) {
+        delta = (cumulativeVolume >= m_lastCumulativeVolume)
+                ? cumulativeVolume - m_lastCumulativeVolume
+                : cumulativeVolume;
+    }
+    m_lastCumulativeVolume = cumulativeVolume;
+
+    if (m_hasBar && start == m_current.time) {
+        m_current.high = qMax(m_current.high, price);
+        m_current.low = qMin(m_current.low, price);
+        m_current.close = price;
+        m_current.volume += delta;
+        return Updated;
+    }
+
+    if (m_hasBar) {
+        m_closed = m_current;
+        m_hasClosedBar = true;
+    }
+
+    m_current.time = start;
+    m_current.open = price;
+    m_current.high = price;
+    m_current.low = price;
+    m_current.close = price;
+    m_current.volume = delta;
+    m_hasBar = true;
+    return NewBar;
+}
+
+void BarBuilder::reset()
+{
+    m_lastCumulativeVolume = -1;
+    m_hasBar = false;
+    m_hasClosedBar = false;
+    m_current = StockBar();
+    m_closed = StockBar();
+}
+
+void BarBuilder::resume(const StockBar &bar)
+{
+    reset();
+    m_current = bar;
+    m_current.time = bucketStart(bar.time);
+    m_hasBar = true;
+}
+
+qint64 BarBuilder::bucketStart(qint64 timestamp) const
+{
+    return alignTimestamp(timestamp, m_intervalMs, m_utcOffsetMs);
+}
+
+qint64 BarBuilder::alignTimestamp(qint64 timestamp, qint64 intervalMs, qint64 utcOffsetMs)
+{
+    // 向下取整的整除，保证1970年之前的时间戳也能正确对齐
+    qint64 local = timestamp + utcOffsetMs;
+    qint64 bucket = local / intervalMs;
+    if (local % intervalMs < 0) {
+        --bucket;
+    }
+    return bucket * intervalMs - utcOffsetMs;
+}
+
+qint64 BarBuilder::localUtcOffsetMs()
+{
+    return static_cast<qint64>(QDateTime::currentDateTime().offsetFromUtc()) * 1000;
+}
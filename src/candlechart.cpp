@@ -0,0 +1,249 @@
+#include "candlechart.h"
+#include "databasehelper.h"
+#include "qcustomplot.h"
+#include <QDateTime>
+#include <QDebug>
+
+namespace {
+
+// 首次加载、每页加载和默认显示的K线数
+const int InitialBars = 120;
+const int PageBars = 200;
+const int VisibleBars = 80;
+
+// 向前翻页遇到休市等空档时，查询窗口逐次加倍的最多次数
+const int MaxPageAttempts = 10;
+
+QVector<QCPFinancialData> toFinancialData(const BarSeries &bars)
+{
+    QVector<QCPFinancialData> data;
+    data.reserve(bars.size());
+    for (int i = 0; i < bars.size(); ++i) {
+        data.append(QCPFinancialData(bars.keys.at(i), bars.open.at(i), bars.high.at(i),
+                                     bars.low.at(i), bars.close.at(i)));
+    }
+    return data;
+}
+
+} // namespace
+
+CandleChart::CandleChart(QCustomPlot *plot, QObject *parent)
+    : QObject(parent)
+    , m_plot(plot)
+    , m_financial(new QCPFinancial(plot->xAxis, plot->yAxis))
+    , m_builder(60 * 1000)
+    , m_intervalSecs(60)
+    , m_active(false)
+    , m_dirty(false)
+    , m_exhausted(false)
+    , m_adjusting(false)
+{
+    // 与行情表格一致：涨为红色，跌为绿色
+    m_financial->setLayer("series");
+    m_financial->setName("K线");
+    m_financial->setChartStyle(QCPFinancial::csCandlestick);
+    m_financial->setTwoColored(true);
+    m_financial->setBrushPositive(QColor(230, 60, 60));
+    m_financial->setBrushNegative(QColor(40, 170, 80));
+    m_financial->setPenPositive(QPen(QColor(230, 60, 60)));
+    m_financial->setPenNegative(QPen(QColor(40, 170, 80)));
+    m_financial->setVisible(false);
+    m_financial->removeFromLegend();
+
+    connect(m_plot->xAxis, QOverload<const QCPRange &>::of(&QCPAxis::rangeChanged),
+            this, &CandleChart::onRangeChanged);
+}
+
+void CandleChart::setActive(bool active)
+{
+    if (m_active == active) {
+        return;
+    }
+
+    m_active = active;
+    m_financial->setVisible(active);
+    if (active) {
+        m_financial->addToLegend();
+        reload();
+    } else {
+        m_financial->removeFromLegend();
+        m_financial->data()->clear();
+    }
+}
+
+void CandleChart::setSymbol(const QString &stockCode)
+{
+    if (m_stockCode == stockCode) {
+        return;
+    }
+
+    m_stockCode = stockCode;
+    if (m_active) {
+        reload();
+    }
+}
+
+void CandleChart::setInterval(int intervalSecs)
+{
+    if (m_intervalSecs == intervalSecs || intervalSecs <= 0) {
+        return;
+    }
+
+    m_intervalSecs = intervalSecs;
+    if (m_active) {
+        reload();
+    }
+}
+
+void CandleChart::addTick(qint64 timestamp, double price, qint64 cumulativeVolume)
+{
+    if (!m_active) {
+        return;
+    }
+
+    BarBuilder::TickResult result = m_builder.addTick(timestamp, price, cumulativeVolume);
+    const StockBar &bar = m_builder.currentBar();
+    if (result == BarBuilder::Updated && !m_financial->data()->isEmpty()) {
+        // 原地修改最后一根K线
+        QCPFinancialDataContainer::iterator last = m_financial->data()->end() - 1;
+        last->high = bar.high;
+        last->low = bar.low;
+        last->close = bar.close;
+        m_dirty = true;
+    } else if (result != BarBuilder::Ignored) {
+        m_financial->addData(bar.time / 1000.0, bar.open, bar.high, bar.low, bar.close);
+        m_dirty = true;
+    }
+}
+
+void CandleChart::refresh()
+{
+    if (!m_active || !m_dirty || m_financial->data()->isEmpty()) {
+        return;
+    }
+    m_dirty = false;
+
+    // 最新K线移出右边界时整体右移，保持跟随最新行情
+    bool rangeChanged = false;
+    const double lastKey = (m_financial->data()->constEnd() - 1)->key;
+    const QCPRange xRange = m_plot->xAxis->range();
+    if (lastKey + m_intervalSecs > xRange.upper && lastKey >= xRange.lower) {
+        m_adjusting = true;
+        m_plot->xAxis->moveRange(lastKey + m_intervalSecs * 5 - xRange.upper);
+        m_adjusting = false;
+        rangeChanged = true;
+    }
+    rangeChanged = fitValueRange() || rangeChanged;
+
+    if (rangeChanged) {
+        m_plot->replot(QCustomPlot::rpQueuedReplot);
+    } else {
+        m_plot->layer("series")->replot();
+    }
+}
+
+void CandleChart::onRangeChanged(const QCPRange &range)
+{
+    if (!m_active || m_adjusting || m_exhausted || m_financial->data()->isEmpty()) {
+        return;
+    }
+
+    // 拖动到已加载的最早K线左侧时加载更早的一页
+    if (range.lower < m_financial->data()->constBegin()->key) {
+        loadOlder();
+    }
+}
+
+void CandleChart::reload()
+{
+    m_financial->data()->clear();
+    m_financial->setWidth(m_intervalSecs * 0.7);
+    m_builder = BarBuilder(m_intervalSecs * 1000LL, BarBuilder::localUtcOffsetMs());
+    m_exhausted = false;
+    m_dirty = false;
+
+    // 横轴格式随周期变化
+    QSharedPointer<QCPAxisTickerDateTime> ticker = m_plot->xAxis->ticker().dynamicCast<QCPAxisTickerDateTime>();
+    if (ticker) {
+        ticker->setDateTimeFormat(m_intervalSecs >= 24 * 3600 ? "yyyy-MM-dd" : "MM-dd hh:mm");
+    }
+
+    if (m_stockCode.isEmpty()) {
+        m_plot->replot(QCustomPlot::rpQueuedReplot);
+        return;
+    }
+
+    const QDateTime now = QDateTime::currentDateTime();
+    BarSeries bars = DatabaseHelper::instance().getStockBars(
+        m_stockCode, m_intervalSecs, now.addSecs(-qint64(m_intervalSecs) * InitialBars), QDateTime());
+    m_financial->setData(bars.keys, bars.open, bars.high, bars.low, bars.close, true);
+
+    // 最后一根K线可能尚未走完，后续tick在其上继续更新
+    double lastKey = now.toMSecsSinceEpoch() / 1000.0;
+    if (!bars.isEmpty()) {
+        StockBar last;
+        last.time = qint64(bars.keys.last() * 1000);
+        last.open = bars.open.last();
+        last.high = bars.high.last();
+        last.low = bars.low.last();
+        last.close = bars.close.last();
+        last.volume = qint64(bars.volume.last());
+        m_builder.resume(last);
+        lastKey = bars.keys.last();
+    }
+
+    m_adjusting = true;
+    m_plot->xAxis->setRange(lastKey - m_intervalSecs * VisibleBars, lastKey + m_intervalSecs * 5);
+    m_adjusting = false;
+    fitValueRange(true);
+    m_plot->replot(QCustomPlot::rpQueuedReplot);
+
+    // 最近一段没有K线时直接向前翻页
+    if (bars.isEmpty()) {
+        loadOlder();
+    }
+}
+
+void CandleChart::loadOlder()
+{
+    const QDateTime end = m_financial->data()->isEmpty()
+                          ? QDateTime::currentDateTime()
+                          : QDateTime::fromMSecsSinceEpoch(qint64(m_financial->data()->constBegin()->key * 1000) - 1);
+
+    // 遇到夜间、周末等空档时逐次扩大查询窗口
+    BarSeries bars;
+    qint64 spanSecs = qint64(m_intervalSecs) * PageBars;
+    for (int attempt = 0; attempt < MaxPageAttempts && bars.isEmpty(); ++attempt) {
+        bars = DatabaseHelper::instance().getStockBars(m_stockCode, m_intervalSecs, end.addSecs(-spanSecs), end);
+        spanSecs *= 2;
+    }
+
+    if (bars.isEmpty()) {
+        m_exhausted = true;
+        qDebug() << "K线已全部加载:" << m_stockCode;
+        return;
+    }
+
+    // 较早的数据加在容器前端，QCPDataContainer为此预留了空间
+    m_financial->data()->add(toFinancialData(bars), true);
+    m_plot->replot(QCustomPlot::rpQueuedReplot);
+}
+
+bool CandleChart::fitValueRange(bool force)
+{
+    bool found = false;
+    QCPRange range = m_financial->getValueRange(found, QCP::sdBoth, m_plot->xAxis->range());
+    if (!found) {
+        return false;
+    }
+
+    const QCPRange current = m_plot->yAxis->range();
+    if (!force && range.lower >= current.lower && range.upper <= current.upper) {
+        return false;
+    }
+
+    // 上下各留5%，小幅波动不需要重绘背景
+    const double margin = qMax(range.size() * 0.05, range.upper * 0.001);
+    m_plot->yAxis->setRange(range.lower - margin, range.upper + margin);
+    return true;
+}
@@ -0,0 +1,160 @@
+#include "chartbenchmark.h"
+#include "minmaxpyramid.h"
+#include "qcustomplot.h"
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QWindow>
+#include <QDebug>
+#include <random>
+
+namespace {
+
+// 平移重绘frames帧，返回每秒帧数
+double measure(QCustomPlot &plot, int frames, const MinMaxPyramid *pyramid)
+{
+    QCPGraph *graph = plot.graph(0);
+    const QCPRange full = plot.xAxis->range();
+    const double step = full.size() / 4 / frames;
+    const int width = qMax(1, plot.axisRect()->width());
+
+    // 先显示完整的四分之三，再逐帧向右平移
+    plot.xAxis->setRange(full.lower, full.lower + full.size() * 3 / 4);
+
+    QVector<double> keys;
+    QVector<double> values;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < frames; ++i) {
+        plot.xAxis->moveRange(step);
+        if (pyramid) {
+            const QCPRange visible = plot.xAxis->range();
+            pyramid->query(visible.lower, visible.upper, width, keys, values);
+            graph->setData(keys, values, true);
+        }
+        plot.replot(QCustomPlot::rpImmediateRefresh);
+        QApplication::processEvents();
+    }
+    const qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+
+    plot.xAxis->setRange(full);
+    return frames * 1000.0 / elapsed;
+}
+
+// 固定种子的随机游走，每秒一个点
+void randomWalk(int points, QVector<double> &keys, QVector<double> &values)
+{
+    keys.resize(points);
+    values.resize(points);
+    std::mt19937 random(42);
+    std::normal_distribution<double> noise(0.0, 0.01);
+    double price = 10.0;
+    for (int i = 0; i < points; ++i) {
+        keys[i] = i;
+        price = qMax(0.01, price + noise(random));
+        values[i] = price;
+    }
+}
+
+// 等窗口真正显示后再计时
+void waitExposed(QCustomPlot &plot)
+{
+    QElapsedTimer exposeTimer;
+    exposeTimer.start();
+    while ((!plot.windowHandle() || !plot.windowHandle()->isExposed()) && exposeTimer.elapsed() < 2000) {
+        QApplication::processEvents(QEventLoop::AllEvents, 50);
+    }
+}
+
+} // namespace
+
+int ChartBenchmark::run(int points, int frames)
+{
+    QVector<double> keys;
+    QVector<double> values;
+    randomWalk(points, keys, values);
+
+    MinMaxPyramid pyramid;
+    for (int i = 0; i < points; ++i) {
+        pyramid.append(keys.at(i), values.at(i));
+    }
+
+    QCustomPlot plot;
+    plot.resize(1280, 720);
+    plot.addGraph();
+    plot.graph(0)->setPen(QPen(Qt::blue));
+    plot.xAxis->setRange(0, points);
+    plot.yAxis->setRange(0, 20);
+    plot.show();
+    waitExposed(plot);
+
+    qInfo() << "图表帧率测试:" << points << "个点," << frames << "帧";
+
+    // 软件绘制，全部点交给QCPGraph
+    plot.graph(0)->setData(keys, values, true);
+    qInfo().noquote() << QString("  软件绘制           %1 fps").arg(measure(plot, frames, nullptr), 0, 'f', 1);
+    qInfo().noquote() << QString("  软件绘制 + 抽稀    %1 fps").arg(measure(plot, frames, &pyramid), 0, 'f', 1);
+
+    // 编译时未启用或无法创建上下文时setOpenGl不生效
+    plot.setOpenGl(true);
+    if (plot.openGl()) {
+        plot.graph(0)->setData(keys, values, true);
+        qInfo().noquote() << QString("  OpenGL             %1 fps").arg(measure(plot, frames, nullptr), 0, 'f', 1);
+        qInfo().noquote() << QString("  OpenGL + 抽稀      %1 fps").arg(measure(plot, frames, &pyramid), 0, 'f', 1);
+    } else {
+        qInfo() << "  OpenGL 不可用，已跳过";
+    }
+    return 0;
+}
+
+int ChartBenchmark::runUpdate(int points, int updates)
+{
+    // 多生成updates个点作为陆续到达的新点
+    QVector<double> keys;
+    QVector<double> values;
+    randomWalk(points + updates, keys, values);
+
+    // 与分时图相同：曲线放在主层之上的独立缓冲层
+    QCustomPlot plot;
+    plot.resize(1280, 720);
+    plot.addLayer("series", plot.layer("main"), QCustomPlot::limAbove);
+    plot.layer("series")->setMode(QCPLayer::lmBuffered);
+    plot.addGraph();
+    plot.graph(0)->setLayer("series");
+    plot.graph(0)->setPen(QPen(Qt::blue));
+    // 新点始终落在坐标范围内，增量方式不需要重绘背景
+    plot.xAxis->setRange(0, points + updates);
+    plot.yAxis->setRange(0, 20);
+    plot.show();
+    waitExposed(plot);
+
+    qInfo() << "分时图更新测试:" << points << "个点," << updates << "次更新";
+
+    // 增量：追加一个点，丢弃最早的点，只重绘曲线层
+    QCPGraph *graph = plot.graph(0);
+    graph->setData(keys.mid(0, points), values.mid(0, points), true);
+    plot.replot(QCustomPlot::rpImmediateRefresh);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = points; i < points + updates; ++i) {
+        graph->addData(keys.at(i), values.at(i));
+        graph->data()->removeBefore(keys.at(i - points + 1));
+        plot.layer("series")->replot();
+        QApplication::processEvents();
+    }
+    const double incremental = timer.nsecsElapsed() / 1e6 / updates;
+
+    // 全量：每次把整个序列交给setData并重绘整个图表
+    graph->setData(keys.mid(0, points), values.mid(0, points), true);
+    plot.replot(QCustomPlot::rpImmediateRefresh);
+    timer.restart();
+    for (int i = points; i < points + updates; ++i) {
+        graph->setData(keys.mid(i - points + 1, points), values.mid(i - points + 1, points), true);
+        plot.replot(QCustomPlot::rpImmediateRefresh);
+        QApplication::processEvents();
+    }
+    const double full = timer.nsecsElapsed() / 1e6 / updates;
+
+    qInfo().noquote() << QString("  增量追加 + 曲线层重绘   %1 ms/次").arg(incremental, 0, 'f', 3);
+    qInfo().noquote() << QString("  setData + 整体重绘      %1 ms/次").arg(full, 0, 'f', 3);
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "chartcrosshair.h"
+#include "numberformatter.h"
+#include "qcustomplot.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <QTimer>
+#include <QDateTime>
+
+namespace {
+
+// 时间上离key最近的点，data按时间有序且不为空
+template <class Container>
+typename Container::const_iterator nearest(const QSharedPointer<Container> &data, double key)
+{
+    // findBegin(key, false)用二分查找第一个不早于key的点
+    typename Container::const_iterator it = data->findBegin(key, false);
+    if (it == data->constEnd()) {
+        return it - 1;
+    }
+    if (it != data->constBegin() && key - (it - 1)->key < it->key - key) {
+        --it;
+    }
+    return it;
+}
+
+QString formatTime(double key, const QString &format)
+{
+    return QDateTime::fromMSecsSinceEpoch(qint64(key * 1000)).toString(format);
+}
+
+} // namespace
+
+ChartCrosshair::ChartCrosshair(QCustomPlot *plot, QObject *parent)
+    : QObject(parent)
+    , m_plot(plot)
+    , m_verticalLine(new QCPItemStraightLine(plot))
+    , m_horizontalLine(new QCPItemStraightLine(plot))
+    , m_tracer(new QCPItemTracer(plot))
+    , m_label(new QCPItemText(plot))
+    , m_throttle(new QTimer(this))
+    , m_hovering(false)
+{
+    for (QCPAbstractItem *item : {static_cast<QCPAbstractItem *>(m_verticalLine),
+                                  static_cast<QCPAbstractItem *>(m_horizontalLine),
+                                  static_cast<QCPAbstractItem *>(m_tracer),
+                                  static_cast<QCPAbstractItem *>(m_label)}) {
+        item->setLayer("overlay");
+        item->setSelectable(false);
+    }
+
+    m_tracer->setStyle(QCPItemTracer::tsCircle);
+    m_tracer->setSize(7);
+
+    // 提示固定在坐标区左上角，不遮挡光标附近的曲线
+    m_label->position->setType(QCPItemPosition::ptAxisRectRatio);
+    m_label->position->setCoords(0.01, 0.02);
+    m_label->setPositionAlignment(Qt::AlignLeft | Qt::AlignTop);
+    m_label->setTextAlignment(Qt::AlignLeft);
+    m_label->setPadding(QMargins(6, 4, 6, 4));
+
+    setDarkTheme(false);
+    setVisible(false);
+
+    // 按屏幕刷新率合并鼠标移动
+    const QScreen *screen = QGuiApplication::primaryScreen();
+    const qreal refreshRate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60.0;
+    m_throttle->setSingleShot(true);
+    m_throttle->setInterval(qMax(1, qRound(1000.0 / refreshRate)));
+    connect(m_throttle, &QTimer::timeout, this, &ChartCrosshair::updateCrosshair);
+
+    // 不按键时也要收到鼠标移动
+    m_plot->setMouseTracking(true);
+    m_plot->installEventFilter(this);
+    connect(m_plot, &QCustomPlot::mouseMove, this, &ChartCrosshair::onMouseMove);
+}
+
+void ChartCrosshair::setDarkTheme(bool dark)
+{
+    const QColor lineColor = dark ? QColor(180, 180, 180) : QColor(120, 120, 120);
+    m_verticalLine->setPen(QPen(lineColor, 0, Qt::DashLine));
+    m_horizontalLine->setPen(QPen(lineColor, 0, Qt::DashLine));
+    m_tracer->setPen(QPen(lineColor));
+    m_label->setPen(QPen(lineColor));
+    m_label->setColor(dark ? Qt::white : Qt::black);
+    m_label->setBrush(dark ? QColor(60, 60, 60, 220) : QColor(255, 255, 255, 220));
+}
+
+bool ChartCrosshair::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_plot && event->type() == QEvent::Leave) {
+        m_hovering = false;
+        m_throttle->stop();
+        setVisible(false);
+        m_plot->layer("overlay")->replot();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void ChartCrosshair::onMouseMove(QMouseEvent *event)
+{
+    // 只记下位置，同一帧内的多次移动只更新一次
+    m_mousePos = event->pos();
+    m_hovering = true;
+    if (!m_throttle->isActive()) {
+        m_throttle->start();
+    }
+}
+
+void ChartCrosshair::updateCrosshair()
+{
+    if (!m_hovering) {
+        return;
+    }
+
+    bool found = false;
+    double key = 0;
+    double value = 0;
+    QString text;
+    if (m_plot->axisRect()->rect().contains(m_mousePos)) {
+        const double mouseKey = m_plot->xAxis->pixelToCoord(m_mousePos.x());
+        for (int i = 0; i < m_plot->plottableCount() && !found; ++i) {
+            QCPAbstractPlottable *plottable = m_plot->plottable(i);
+            if (!plottable->visible()) {
+                continue;
+            }
+
+            if (QCPGraph *graph = qobject_cast<QCPGraph *>(plottable)) {
+                if (graph->data()->isEmpty()) {
+                    continue;
+                }
+                QCPGraphDataContainer::const_iterator it = nearest(graph->data(), mouseKey);
+                key = it->key;
+                value = it->value;
+                text = QString("%1  %2").arg(formatTime(key, "hh:mm:ss"), NumberFormatter::fixed(value, 2));
+                found = true;
+            } else if (QCPFinancial *financial = qobject_cast<QCPFinancial *>(plottable)) {
+                if (financial->data()->isEmpty()) {
+                    continue;
+                }
+                QCPFinancialDataContainer::const_iterator it = nearest(financial->data(), mouseKey);
+                key = it->key;
+                value = it->close;
+                text = QString("%1\n开 %2  高 %3\n低 %4  收 %5")
+                       .arg(formatTime(key, "yyyy-MM-dd hh:mm"),
+                            NumberFormatter::fixed(it->open, 2), NumberFormatter::fixed(it->high, 2),
+                            NumberFormatter::fixed(it->low, 2), NumberFormatter::fixed(it->close, 2));
+                found = true;
+            }
+        }
+    }
+
+    if (found) {
+        m_verticalLine->point1->setCoords(key, 0);
+        m_verticalLine->point2->setCoords(key, 1);
+        m_horizontalLine->point1->setCoords(0, value);
+        m_horizontalLine->point2->setCoords(1, value);
+        m_tracer->position->setCoords(key, value);
+        m_label->setText(text);
+    }
+    setVisible(found);
+
+    // 只重绘十字光标所在的层
+    m_plot->layer("overlay")->replot();
+}
+
+void ChartCrosshair::setVisible(bool visible)
+{
+    m_verticalLine->setVisible(visible);
+    m_horizontalLine->setVisible(visible);
+    m_tracer->setVisible(visible);
+    m_label->setVisible(visible);
+}
@@ -0,0 +1,190 @@
+#include "chartgrid.h"
+#include "timeseriesstore.h"
+#include "sparkline.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QtMath>
+
+ChartGrid::ChartGrid(TimeSeriesStore *store, QWidget *parent)
+    : QWidget(parent)
+    , m_store(store)
+    , m_columns(1)
+    , m_rows(1)
+    , m_darkTheme(false)
+    , m_frameNs(0)
+    , m_frameCount(0)
+    , m_cellsDrawn(0)
+{
+    // 整个控件由后备图像覆盖，不需要Qt先擦除背景
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void ChartGrid::setSymbols(const QStringList &stockCodes)
+{
+    m_stockCodes = stockCodes.mid(0, MaxCharts);
+    m_cellIndex.clear();
+    for (int i = 0; i < m_stockCodes.size(); ++i) {
+        m_cellIndex.insert(m_stockCodes.at(i), i);
+    }
+
+    // 尽量接近正方形的排列
+    const int count = qMax(1, m_stockCodes.size());
+    m_columns = qCeil(qSqrt(count));
+    m_rows = (count + m_columns - 1) / m_columns;
+
+    if (isVisible()) {
+        touchSymbols();
+    }
+    markAllDirty();
+    refresh();
+}
+
+void ChartGrid::touchSymbols()
+{
+    // 网格里的图表算作被查看，推迟淘汰
+    for (const QString &code : qAsConst(m_stockCodes)) {
+        m_store->touch(code);
+    }
+}
+
+void ChartGrid::setDarkTheme(bool dark)
+{
+    m_darkTheme = dark;
+    markAllDirty();
+    refresh();
+}
+
+void ChartGrid::markDirty(const QString &stockCode)
+{
+    auto it = m_cellIndex.constFind(stockCode);
+    if (it != m_cellIndex.constEnd()) {
+        m_dirtyCells.insert(it.value());
+    }
+}
+
+void ChartGrid::markAllDirty()
+{
+    for (int i = 0; i < m_rows * m_columns; ++i) {
+        m_dirtyCells.insert(i);
+    }
+}
+
+void ChartGrid::refresh()
+{
+    // 不可见时保留脏标记，显示时再画
+    if (m_dirtyCells.isEmpty() || m_image.isNull() || !isVisible()) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QRegion region;
+    {
+        QPainter painter(&m_image);
+        for (int index : qAsConst(m_dirtyCells)) {
+            drawCell(painter, index);
+            region += cellRect(index);
+        }
+    }
+    m_cellsDrawn += m_dirtyCells.size();
+    m_dirtyCells.clear();
+    update(region);
+
+    // 每100帧输出一次平均耗时
+    m_frameNs += timer.nsecsElapsed();
+    if (++m_frameCount == 100) {
+        qDebug() << "多图:" << m_stockCodes.size() << "只股票, 平均"
+                 << m_frameNs / m_frameCount / 1000 << "us/帧, 每帧重画"
+                 << m_cellsDrawn / m_frameCount << "格";
+        m_frameNs = 0;
+        m_frameCount = 0;
+        m_cellsDrawn = 0;
+    }
+}
+
+QRect ChartGrid::cellRect(int index) const
+{
+    const int column = index % m_columns;
+    const int row = index / m_columns;
+    const int left = column * width() / m_columns;
+    const int top = row * height() / m_rows;
+    const int right = (column + 1) * width() / m_columns;
+    const int bottom = (row + 1) * height() / m_rows;
+    return QRect(left, top, right - left, bottom - top);
+}
+
+void ChartGrid::drawCell(QPainter &painter, int index)
+{
+    const QRect rect = cellRect(index);
+    const QColor background = m_darkTheme ? QColor(43, 43, 43) : QColor(255, 255, 255);
+    const QColor border = m_darkTheme ? QColor(80, 80, 80) : QColor(200, 200, 200);
+    const QColor text = m_darkTheme ? Qt::white : Qt::black;
+
+    painter.fillRect(rect, background);
+    painter.setPen(border);
+    painter.drawRect(rect.adjusted(0, 0, -1, -1));
+    if (index >= m_stockCodes.size()) {
+        return;
+    }
+
+    const QString &code = m_stockCodes.at(index);
+    const QRect labelRect = rect.adjusted(4, 2, -4, 0);
+    painter.setPen(text);
+    painter.drawText(labelRect, Qt::AlignLeft | Qt::AlignTop, code.mid(2));
+
+    TimeSeriesStore::Series *series = m_store->series(code);
+    const int count = series ? series->snapshot(m_keys, m_values) : 0;
+    if (count < 2) {
+        return;
+    }
+
+    // 最新价和窗口内涨跌
+    const QColor lineColor = Sparkline::trendColor(m_values.first(), m_values.last());
+    painter.setPen(lineColor);
+    painter.drawText(labelRect, Qt::AlignRight | Qt::AlignTop, QString::number(m_values.last(), 'f', 2));
+
+    const QRect plot = rect.adjusted(4, painter.fontMetrics().height() + 4, -4, -4);
+    Sparkline::buildPath(m_keys, m_values, plot, m_points);
+    painter.drawPolyline(m_points.constData(), m_points.size());
+}
+
+void ChartGrid::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    painter.drawImage(event->rect(), m_image, QRectF(QPointF(event->rect().topLeft()) * m_image.devicePixelRatio(),
+                                                     QSizeF(event->rect().size()) * m_image.devicePixelRatio()));
+}
+
+void ChartGrid::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+
+    const qreal ratio = devicePixelRatioF();
+    m_image = QImage(size() * ratio, QImage::Format_ARGB32_Premultiplied);
+    m_image.setDevicePixelRatio(ratio);
+    markAllDirty();
+    refresh();
+}
+
+void ChartGrid::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+
+    touchSymbols();
+    // 隐藏期间积累的变化
+    refresh();
+}
+
+void ChartGrid::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    const int column = event->pos().x() * m_columns / qMax(1, width());
+    const int row = event->pos().y() * m_rows / qMax(1, height());
+    const int index = row * m_columns + column;
+    if (index >= 0 && index < m_stockCodes.size()) {
+        emit symbolActivated(m_stockCodes.at(index));
+    }
+}
@@ -0,0 +1,412 @@
+#include "columnartickstore.h"
+#include "databasehelper.h"
+#include "tickcodec.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char FileMagic[4] = { 'T', 'K', 'C', '1' };
+const quint32 FileVersion = 1;
+const char FileSuffix[] = ".tkc";
+
+static_assert(sizeof(ColumnarTickStore::FileHeader) == 64, "文件头必须为64字节");
+static_assert(sizeof(ColumnarTickStore::Block) % 8 == 0, "数据块须按8字节对齐");
+
+bool validHeader(const ColumnarTickStore::FileHeader &header)
+{
+    return std::memcmp(header.magic, FileMagic, sizeof(FileMagic)) == 0
+           && header.version == FileVersion
+           && header.blockCapacity == ColumnarTickStore::BlockCapacity
+           && header.priceScale == ColumnarTickStore::PriceScale;
+}
+
+} // namespace
+
+ColumnarTickStore::Reader::Reader(const QString &path)
+    : m_file(path)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const qint64 size = m_file.size();
+    const qint64 blockCount = (size - qint64(sizeof(FileHeader))) / qint64(sizeof(Block));
+    if (blockCount <= 0) {
+        return;
+    }
+
+    // 只映射完整的块，写入中途的残块不可见
+    const qint64 mappedSize = qint64(sizeof(FileHeader)) + blockCount * qint64(sizeof(Block));
+    m_map = m_file.map(0, mappedSize);
+    if (!m_map) {
+        qDebug() << "映射列式文件失败:" << path << m_file.errorString();
+        return;
+    }
+
+    if (!validHeader(*reinterpret_cast<const FileHeader *>(m_map))) {
+        qDebug() << "列式文件格式不匹配:" << path;
+        m_file.unmap(m_map);
+        m_map = nullptr;
+        return;
+    }
+
+    m_blocks = reinterpret_cast<const Block *>(m_map + sizeof(FileHeader));
+    m_blockCount = int(blockCount);
+}
+
+ColumnarTickStore::Reader::~Reader()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+    }
+}
+
+int ColumnarTickStore::Reader::seekBlock(qint64 timestamp) const
+{
+    // 块按时间追加，末笔时间单调递增
+    int low = 0;
+    int high = m_blockCount;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (m_blocks[mid].lastTime < timestamp) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+int ColumnarTickStore::Reader::lastBlockBefore(qint64 timestamp) const
+{
+    int low = 0;
+    int high = m_blockCount;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (m_blocks[mid].baseTime <= timestamp) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low - 1;
+}
+
+int ColumnarTickStore::Reader::readSeries(qint64 fromMs, qint64 toMs,
+                                          QVector<double> &keys, QVector<double> &prices) const
+{
+    const int before = keys.size();
+    forEachTick(fromMs, toMs, [&](qint64 timestamp, double price, qint64) {
+        keys.append(timestamp / 1000.0);
+        prices.append(price);
+    });
+    return keys.size() - before;
+}
+
+ColumnarTickStore::Writer::Writer(const QString &path)
+    : m_path(path)
+{
+}
+
+bool ColumnarTickStore::Writer::load()
+{
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+
+    m_file.reset(new QFile(m_path));
+    QFile &file = *m_file;
+    if (!file.open(QIODevice::ReadWrite)) {
+        qDebug() << "打开列式文件失败:" << m_path << file.errorString();
+        m_file.reset();
+        return false;
+    }
+
+    std::memset(&m_tail, 0, sizeof(m_tail));
+    m_written = 0;
+    m_dirty = false;
+
+    // 新文件先写入文件头
+    if (file.size() < qint64(sizeof(FileHeader))) {
+        FileHeader header = {};
+        std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+        header.version = FileVersion;
+        header.blockCapacity = BlockCapacity;
+        header.priceScale = PriceScale;
+        if (!file.resize(0) || file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header)) {
+            qDebug() << "写入列式文件头失败:" << m_path << file.errorString();
+            m_file.reset();
+            return false;
+        }
+        m_tailOffset = sizeof(FileHeader);
+        return true;
+    }
+
+    FileHeader header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header) || !validHeader(header)) {
+        qDebug() << "列式文件格式不匹配:" << m_path;
+        m_file.reset();
+        return false;
+    }
+
+    // 从最后一个完整的块继续追加，写入中断留下的残块会被覆盖
+    const qint64 blockCount = (file.size() - qint64(sizeof(FileHeader))) / qint64(sizeof(Block));
+    if (blockCount == 0) {
+        m_tailOffset = sizeof(FileHeader);
+        return true;
+    }
+
+    m_tailOffset = qint64(sizeof(FileHeader)) + (blockCount - 1) * qint64(sizeof(Block));
+    if (!file.seek(m_tailOffset)
+        || file.read(reinterpret_cast<char *>(&m_tail), sizeof(m_tail)) != sizeof(m_tail)
+        || m_tail.count > BlockCapacity) {
+        qDebug() << "读取列式文件尾块失败:" << m_path;
+        m_file.reset();
+        m_tailOffset = -1;
+        return false;
+    }
+    m_written = m_tail.count;
+    return true;
+}
+
+bool ColumnarTickStore::Writer::writeTail()
+{
+    struct Range {
+        qint64 offset;
+        qint64 size;
+    };
+
+    // 新块整块写出，文件长度立即覆盖整块，读取器和重新加载才认得它；
+    // 之后按列只写新增的tick，最后写块头，中断时块头中的数量不会超过已写入的数据
+    QVector<Range> ranges;
+    if (m_written == 0) {
+        ranges.append({ 0, qint64(sizeof(Block)) });
+    } else {
+        const qint64 first = m_written;
+        const qint64 count = qint64(m_tail.count) - first;
+        ranges.append({ qint64(offsetof(Block, timeDelta)) + first * qint64(sizeof(quint32)), count * qint64(sizeof(quint32)) });
+        ranges.append({ qint64(offsetof(Block, priceDelta)) + first * qint64(sizeof(qint32)), count * qint64(sizeof(qint32)) });
+        ranges.append({ qint64(offsetof(Block, volume)) + first * qint64(sizeof(qint64)), count * qint64(sizeof(qint64)) });
+        ranges.append({ 0, qint64(offsetof(Block, timeDelta)) });
+    }
+
+    const char *tail = reinterpret_cast<const char *>(&m_tail);
+    bool success = true;
+    for (const Range &range : qAsConst(ranges)) {
+        if (!m_file->seek(m_tailOffset + range.offset)
+            || m_file->write(tail + range.offset, range.size) != range.size) {
+            success = false;
+            break;
+        }
+    }
+
+    // 只交给系统缓存，读取器映射文件即可看到
+    if (!success || !m_file->flush()) {
+        qDebug() << "写入列式文件失败:" << m_path << m_file->errorString();
+        // 下次追加时重新打开文件并加载尾块
+        m_file.reset();
+        m_tailOffset = -1;
+        return false;
+    }
+    m_written = m_tail.count;
+    m_dirty = false;
+    return true;
+}
+
+qint64 ColumnarTickStore::Writer::lastTime()
+{
+    if (m_tailOffset < 0 && !load()) {
+        return std::numeric_limits<qint64>::min();
+    }
+    return m_tail.count > 0 ? m_tail.lastTime : std::numeric_limits<qint64>::min();
+}
+
+bool ColumnarTickStore::Writer::append(qint64 timestamp, double price, qint64 volume)
+{
+    if (m_tailOffset < 0 && !load()) {
+        return false;
+    }
+
+    if (m_tail.count > 0 && timestamp < m_tail.lastTime) {
+        qDebug() << "列式存储只能按时间顺序追加:" << m_path << timestamp;
+        return false;
+    }
+
+    const qint64 fixedPrice = qRound64(price * PriceScale);
+
+    // 块已满或差值超出列宽时开始新块
+    if (m_tail.count > 0) {
+        const qint64 timeDelta = timestamp - m_tail.baseTime;
+        const qint64 priceDelta = fixedPrice - m_tail.basePrice;
+        if (m_tail.count >= BlockCapacity
+            || timeDelta > std::numeric_limits<quint32>::max()
+            || priceDelta > std::numeric_limits<qint32>::max()
+            || priceDelta < std::numeric_limits<qint32>::min()) {
+            if (m_dirty && !writeTail()) {
+                return false;
+            }
+            m_tailOffset += sizeof(Block);
+            std::memset(&m_tail, 0, sizeof(m_tail));
+            m_written = 0;
+        }
+    }
+
+    if (m_tail.count == 0) {
+        m_tail.baseTime = timestamp;
+        m_tail.basePrice = fixedPrice;
+    }
+
+    const int index = int(m_tail.count);
+    m_tail.timeDelta[index] = quint32(timestamp - m_tail.baseTime);
+    m_tail.priceDelta[index] = qint32(fixedPrice - m_tail.basePrice);
+    m_tail.volume[index] = volume;
+    m_tail.lastTime = timestamp;
+    ++m_tail.count;
+    m_dirty = true;
+
+    return true;
+}
+
+bool ColumnarTickStore::Writer::flush()
+{
+    // 写入失败后尾块已作废，等下次追加重新加载
+    return !m_dirty || (m_tailOffset >= 0 && writeTail());
+}
+
+QString ColumnarTickStore::directory()
+{
+    QString path = DatabaseHelper::dataDirectory() + "/columnar";
+    QDir().mkpath(path);
+    return path;
+}
+
+QString ColumnarTickStore::filePath(const QString &stockCode)
+{
+    return directory() + "/" + stockCode + FileSuffix;
+}
+
+QStringList ColumnarTickStore::stockCodes()
+{
+    QStringList codes;
+    const QFileInfoList files = QDir(directory()).entryInfoList({ QString("*") + FileSuffix },
+                                                                QDir::Files, QDir::Name);
+    for (const QFileInfo &info : files) {
+        codes.append(info.completeBaseName());
+    }
+    return codes;
+}
+
+int ColumnarTickStore::convertFromDatabase(QSqlDatabase &db, const QString &attachedKey)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const qint64 minTime = std::numeric_limits<qint64>::min();
+    const qint64 maxTime = std::numeric_limits<qint64>::max();
+
+    QStringList codes;
+    DatabaseHelper::forEachTickTable(db, minTime, maxTime, false, [&](const QString &table) {
+        const QStringList tableCodes = DatabaseHelper::listStockCodes(db, table);
+        for (const QString &code : tableCodes) {
+            if (!codes.contains(code)) {
+                codes.append(code);
+            }
+        }
+        return true;
+    }, [&](const QString &archive) {
+        const QStringList archiveCodes = TickArchive::stockCodes(archive);
+        for (const QString &code : archiveCodes) {
+            if (!codes.contains(code)) {
+                codes.append(code);
+            }
+        }
+        return true;
+    }, attachedKey);
+
+    int converted = 0;
+    qint64 totalTicks = 0;
+    for (const QString &code : codes) {
+        // 先写临时文件再替换，转换中途失败不影响已有文件
+        const QString path = filePath(code);
+        const QString temp = path + ".tmp";
+        QFile::remove(temp);
+
+        Writer writer(temp);
+        bool success = true;
+        qint64 ticks = 0;
+        qint64 skipped = 0;
+
+        auto append = [&](qint64 timestamp, double price, qint64 volume) {
+            if (timestamp < writer.lastTime()) {
+                ++skipped;
+                return true;
+            }
+            if (!writer.append(timestamp, price, volume)) {
+                success = false;
+                return false;
+            }
+            ++ticks;
+            return true;
+        };
+
+        DatabaseHelper::forEachTickTable(db, minTime, maxTime, false, [&](const QString &table) {
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.prepare(QString("SELECT timestamp, price, volume FROM %1 "
+                                  "WHERE stock_code = ? ORDER BY timestamp").arg(table));
+            query.addBindValue(code);
+
+            if (!query.exec()) {
+                qDebug() << "读取tick失败:" << code << query.lastError().text();
+                success = false;
+                return false;
+            }
+
+            while (query.next()) {
+                if (!append(query.value(0).toLongLong(), query.value(1).toDouble(), query.value(2).toLongLong())) {
+                    return false;
+                }
+            }
+            return true;
+        }, [&](const QString &archive) {
+            TickRows rows;
+            if (!TickArchive::readRows(archive, code, rows)) {
+                success = false;
+                return false;
+            }
+            for (int i = 0; i < rows.size(); ++i) {
+                if (!append(rows.timestamps.at(i), TickCodec::fromFixed(rows.prices.at(i)), rows.volumes.at(i))) {
+                    return false;
+                }
+            }
+            return true;
+        }, attachedKey);
+
+        if (!success || !writer.flush()) {
+            QFile::remove(temp);
+            continue;
+        }
+
+        QFile::remove(path);
+        if (!QFile::rename(temp, path)) {
+            qDebug() << "替换列式文件失败:" << path;
+            QFile::remove(temp);
+            continue;
+        }
+
+        if (skipped > 0) {
+            qDebug() << "跳过乱序tick:" << code << skipped << "笔";
+        }
+        ++converted;
+        totalTicks += ticks;
+    }
+
+    qDebug() << "转换列式存储:" << converted << "只股票," << totalTicks << "笔, 耗时" << timer.elapsed() << "ms";
+    return converted;
+}
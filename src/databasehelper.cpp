@@ -1,9 +1,69 @@
 
 #include "databasehelper.h"
+#include "tickpartitions.h"
+#include "tickcodec.h"
 #include <QDir>
+#include <QFileInfo>
+#include <QSettings>
+#include <QSet>
 #include <QStandardPaths>
 #include <QVariantList>
 #include <QVariantMap>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QTimer>
+#include <QUrl>
+#include <vector>
+#include <limits>
+
+namespace {
+
+// 列式模式下未写满的尾块最多在内存中停留的时间
+const int ColumnarFlushMs = 1000;
+
+// 同时生成各物化周期的K线，跨表输入时保持状态，分区边界上的K线不会被截断
+class BarAggregator
+{
+public:
+    explicit BarAggregator(QVector<QVector<StockBar>> &bars)
+        : m_bars(bars)
+    {
+        const qint64 utcOffsetMs = BarBuilder::localUtcOffsetMs();
+        for (int intervalSecs : DatabaseHelper::barIntervals()) {
+            m_builders.emplace_back(intervalSecs * 1000LL, utcOffsetMs);
+        }
+        m_bars.clear();
+        m_bars.resize(DatabaseHelper::barIntervals().size());
+    }
+
+    void addTick(qint64 timestamp, double price, qint64 volume)
+    {
+        for (size_t i = 0; i < m_builders.size(); ++i) {
+            if (m_builders[i].addTick(timestamp, price, volume) == BarBuilder::NewBar
+                && m_builders[i].hasClosedBar()) {
+                m_bars[static_cast<int>(i)].append(m_builders[i].lastClosedBar());
+            }
+        }
+    }
+
+    // 输入结束，补上未收盘的K线
+    void finish()
+    {
+        for (size_t i = 0; i < m_builders.size(); ++i) {
+            if (m_builders[i].hasBar()) {
+                m_bars[static_cast<int>(i)].append(m_builders[i].currentBar());
+            }
+        }
+    }
+
+private:
+    QVector<QVector<StockBar>> &m_bars;
+    std::vector<BarBuilder> m_builders;
+};
+
+} // namespace
 
 DatabaseHelper& DatabaseHelper::instance()
 {
@@ -14,81 +74,191 @@ DatabaseHelper& DatabaseHelper::instance()
 DatabaseHelper::DatabaseHelper(QObject *parent)
     : QObject(parent)
     , m_initialized(false)
+    , m_needsBarRebuild(false)
+    , m_storageMode(SingleFile)
+    , m_compressAfterDays(7)
+    , m_columnarFlushTimer(nullptr)
 {
 }
 
 DatabaseHelper::~DatabaseHelper()
 {
+    flushColumnarWriters();
+    m_insertTickQuery = QSqlQuery();
+    m_upsertBarQuery = QSqlQuery();
     if (m_db.isOpen()) {
         m_db.close();
     }
 }
 
-bool DatabaseHelper::initializeDatabase()
+const QList<int> &DatabaseHelper::barIntervals()
 {
-    if (m_initialized) {
-        return true;
-    }
+    static const QList<int> intervals = { 60, 300, 3600, 86400 };
+    return intervals;
+}
 
+QString DatabaseHelper::dataDirectory()
+{
     // 获取应用程序数据目录
     QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     QDir dir(dataPath);
     if (!dir.exists()) {
         dir.mkpath(dataPath);
     }
+    return dataPath;
+}
+
+bool DatabaseHelper::saveStorageMode(StorageMode mode)
+{
+    static const char *names[] = { "single", "daily", "weekly", "columnar" };
+
+    QSettings settings(dataDirectory() + "/tickerlite.ini", QSettings::IniFormat);
+    settings.setValue("storage/mode", names[mode]);
+    settings.sync();
+    return settings.status() == QSettings::NoError;
+}
+
+QString DatabaseHelper::defaultDatabasePath()
+{
+    return dataDirectory() + "/ticker_data.db";
+}
+
+bool DatabaseHelper::prepareSchema()
+{
+    Connection connection("prepare_schema", defaultDatabasePath());
+    if (!connection.isOpen()) {
+        return false;
+    }
+
+    QSqlDatabase db = connection.database();
+    return createSchema(db);
+}
+
+bool DatabaseHelper::createSchema(QSqlDatabase &db)
+{
+    // WAL模式下后台清理与读取不会阻塞行情写入，该设置保存在数据库文件中
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA journal_mode=WAL")) {
+        qDebug() << "设置日志模式失败:" << query.lastError().text();
+    }
+
+    // 创建股票数据表，分区模式下保存切换前的数据
+    if (!createTickTable(db, "main")) {
+        return false;
+    }
+
+    // 创建股票代码索引，提高查询效率
+    bool success = query.exec("CREATE INDEX IF NOT EXISTS idx_stock_code ON stock_data(stock_code)");
+    if (!success) {
+        qDebug() << "创建索引失败:" << query.lastError().text();
+        return false;
+    }
+
+    // 创建分区目录表
+    if (!TickPartitions::ensureCatalog(db)) {
+        return false;
+    }
+
+    // 创建K线物化表，每个周期一组，写入tick时在同一事务中更新当前K线
+    success = query.exec(
+        "CREATE TABLE IF NOT EXISTS stock_bars ("
+        "stock_code TEXT NOT NULL, "
+        "interval_sec INTEGER NOT NULL, "
+        "bar_time INTEGER NOT NULL, "
+        "open REAL NOT NULL, "
+        "high REAL NOT NULL, "
+        "low REAL NOT NULL, "
+        "close REAL NOT NULL, "
+        "volume INTEGER NOT NULL DEFAULT 0, "
+        "PRIMARY KEY (stock_code, interval_sec, bar_time)"
+        ") WITHOUT ROWID"
+    );
+
+    if (!success) {
+        qDebug() << "创建K线表失败:" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+bool DatabaseHelper::initializeDatabase()
+{
+    if (m_initialized) {
+        return true;
+    }
+
+    QString dataPath = dataDirectory();
+
+    // 读取存储方式
+    QSettings settings(dataPath + "/tickerlite.ini", QSettings::IniFormat);
+    QString mode = settings.value("storage/mode", "single").toString();
+    m_storageMode = (mode == "daily") ? DailyPartitions
+                    : (mode == "weekly") ? WeeklyPartitions
+                    : (mode == "columnar") ? Columnar : SingleFile;
+    m_compressAfterDays = settings.value("storage/compress_after_days", 7).toInt();
 
     // 数据库文件路径
-    QString dbPath = dataPath + "/ticker_data.db";
+    QString dbPath = defaultDatabasePath();
     qDebug() << "dbpaht:" << dbPath;
 
     // 连接数据库
     m_db = QSqlDatabase::addDatabase("QSQLITE");
     m_db.setDatabaseName(dbPath);
+    // 允许URI文件名，已封存的分区以只读方式挂载
+    m_db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000;QSQLITE_OPEN_URI");
+    m_dbPath = dbPath;
 
     if (!m_db.open()) {
         qDebug() << "无法打开数据库:" << m_db.lastError().text();
         return false;
     }
 
-    // 创建股票数据表
-    QSqlQuery query;
-    bool success = query.exec(
-        "CREATE TABLE IF NOT EXISTS stock_data ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-        "stock_code TEXT NOT NULL, "
-        "name TEXT NOT NULL, "
-        "price REAL NOT NULL, "
-        "prev_close REAL NOT NULL, "
-        "change REAL NOT NULL, "
-        "change_percent REAL NOT NULL, "
-        "open_price REAL NOT NULL, "
-        "volume TEXT, "
-        "outer_disc TEXT, "
-        "inner_disc TEXT, "
-        "timestamp DATETIME DEFAULT CURRENT_TIMESTAMP"
-        ")"
-    );
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA synchronous=NORMAL")) {
+        qDebug() << "设置同步模式失败:" << query.lastError().text();
+    }
 
-    if (!success) {
-        qDebug() << "创建表失败:" << query.lastError().text();
+    // 已由prepareSchema()在后台建好时这里都是空操作
+    if (!createSchema(m_db)) {
         return false;
     }
 
-    // 创建股票代码索引，提高查询效率
-    success = query.exec("CREATE INDEX IF NOT EXISTS idx_stock_code ON stock_data(stock_code)");
-    if (!success) {
-        qDebug() << "创建索引失败:" << query.lastError().text();
+    // K线表为空（新库或旧库首次升级）时需要从已有tick生成K线，重建可能很慢，由调用方安排
+    m_needsBarRebuild = query.exec("SELECT 1 FROM stock_bars LIMIT 1") && !query.next();
+    query.finish();
+
+    // 预编译写入语句，每笔tick复用；分区模式在首次写入时按分区预编译
+    if (m_storageMode == SingleFile && !prepareInsertTick("main.stock_data")) {
         return false;
     }
 
-    // 创建时间戳索引，提高时间范围查询效率
-    success = query.exec("CREATE INDEX IF NOT EXISTS idx_timestamp ON stock_data(timestamp)");
+    m_upsertBarQuery = QSqlQuery(m_db);
+    bool success = m_upsertBarQuery.prepare(
+        "INSERT INTO stock_bars (stock_code, interval_sec, bar_time, open, high, low, close, volume) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?) "
+        "ON CONFLICT(stock_code, interval_sec, bar_time) DO UPDATE SET "
+        "high = MAX(high, excluded.high), "
+        "low = MIN(low, excluded.low), "
+        "close = excluded.close, "
+        "volume = volume + excluded.volume"
+    );
+
     if (!success) {
-        qDebug() << "创建索引失败:" << query.lastError().text();
+        qDebug() << "预编译语句失败:" << m_upsertBarQuery.lastError().text();
         return false;
     }
 
+    // 列式模式下尾块定时落盘，写满的块在追加时就已写出
+    if (m_storageMode == Columnar && !m_columnarFlushTimer) {
+        m_columnarFlushTimer = new QTimer(this);
+        m_columnarFlushTimer->setInterval(ColumnarFlushMs);
+        connect(m_columnarFlushTimer, &QTimer::timeout, this, &DatabaseHelper::flushColumnarWriters);
+        m_columnarFlushTimer->start();
+    }
+
     m_initialized = true;
+
     return true;
 }
 
@@ -104,30 +274,236 @@ bool DatabaseHelper::saveStockData(const QString &stockCode, const QString &name
         return false;
     }
 
-    QSqlQuery query;
-    query.prepare(
-        "INSERT INTO stock_data (stock_code, name, price, prev_close, change, "
+    if (isPartitioned() && !ensureWritePartition(timestamp)) {
+        return false;
+    }
+
+    qint64 cumulativeVolume = volume.toLongLong();
+
+    // 首次见到该股票时以同一交易日最后保存的一笔为基准，重启后不会丢掉这段成交量；
+    // 当天还没有保存过时没有基准，成交量增量记为0
+    qint64 volumeDelta = 0;
+    qint64 previousVolume = 0;
+    bool hasPrevious = false;
+    auto lastVolume = m_lastVolumes.constFind(stockCode);
+    if (lastVolume != m_lastVolumes.constEnd()) {
+        previousVolume = lastVolume.value();
+        hasPrevious = true;
+    } else {
+        hasPrevious = loadLastVolume(stockCode, timestamp, previousVolume);
+    }
+    if (hasPrevious) {
+        volumeDelta = (cumulativeVolume >= previousVolume)
+                      ? cumulativeVolume - previousVolume
+                      : cumulativeVolume;
+    }
+
+    // tick与K线在同一事务中写入，保证两者一致；列式模式下事务中只有K线
+    if (!m_db.transaction()) {
+        qDebug() << "开启事务失败:" << m_db.lastError().text();
+        return false;
+    }
+
+    if (m_storageMode != Columnar) {
+        m_insertTickQuery.bindValue(0, stockCode);
+        m_insertTickQuery.bindValue(1, name);
+        m_insertTickQuery.bindValue(2, price);
+        m_insertTickQuery.bindValue(3, prevClose);
+        m_insertTickQuery.bindValue(4, change);
+        m_insertTickQuery.bindValue(5, changePercent);
+        m_insertTickQuery.bindValue(6, openPrice);
+        m_insertTickQuery.bindValue(7, volume);
+        m_insertTickQuery.bindValue(8, outerDisc);
+        m_insertTickQuery.bindValue(9, innerDisc);
+        m_insertTickQuery.bindValue(10, timestamp);
+
+        if (!m_insertTickQuery.exec()) {
+            qDebug() << "保存股票数据失败:" << m_insertTickQuery.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+    }
+
+    if (!upsertBars(stockCode, price, volumeDelta, timestamp)) {
+        m_db.rollback();
+        return false;
+    }
+
+    if (!m_db.commit()) {
+        qDebug() << "提交事务失败:" << m_db.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+
+    m_lastVolumes.insert(stockCode, cumulativeVolume);
+
+    // 列式文件不在事务中，K线提交成功后再追加，回滚时不会留下多出的tick
+    if (m_storageMode == Columnar) {
+        auto writer = m_columnarWriters.find(stockCode);
+        if (writer == m_columnarWriters.end()) {
+            writer = m_columnarWriters.insert(stockCode,
+                                              ColumnarTickStore::Writer(ColumnarTickStore::filePath(stockCode)));
+        }
+        if (!writer->append(timestamp, price, cumulativeVolume)) {
+            qDebug() << "追加列式tick失败:" << stockCode;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DatabaseHelper::loadLastVolume(const QString &stockCode, qint64 timestamp, qint64 &volume)
+{
+    // 成交量是日内累计值，只取同一交易日内的
+    const qint64 dayStart = BarBuilder::alignTimestamp(timestamp, 86400000LL, BarBuilder::localUtcOffsetMs());
+    bool found = false;
+
+    if (m_storageMode == Columnar) {
+        // 先写出尾块，读取器才能看到最新的一笔
+        auto writer = m_columnarWriters.find(stockCode);
+        if (writer != m_columnarWriters.end()) {
+            writer->flush();
+        }
+
+        ColumnarTickStore::Reader reader(ColumnarTickStore::filePath(stockCode));
+        if (reader.isOpen() && reader.blockCount() > 0) {
+            const ColumnarTickStore::Block &block = reader.block(reader.blockCount() - 1);
+            const int count = int(qMin<quint32>(block.count, ColumnarTickStore::BlockCapacity));
+            if (count > 0 && block.lastTime >= dayStart) {
+                volume = block.volume[count - 1];
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    forEachTickTable(m_db, dayStart, timestamp, true, [&](const QString &table) {
+        QSqlQuery query(m_db);
+        query.prepare(QString("SELECT volume FROM %1 WHERE stock_code = ? AND timestamp >= ? "
+                              "ORDER BY timestamp DESC LIMIT 1").arg(table));
+        query.addBindValue(stockCode);
+        query.addBindValue(dayStart);
+        if (query.exec() && query.next()) {
+            volume = query.value(0).toLongLong();
+            found = true;
+        }
+        return !found;
+    }, [&](const QString &archive) {
+        TickRows rows;
+        if (TickArchive::readRows(archive, stockCode, rows) && rows.size() > 0
+            && rows.timestamps.last() >= dayStart) {
+            volume = rows.volumes.last();
+            found = true;
+        }
+        return !found;
+    }, m_currentPartition);
+
+    return found;
+}
+
+void DatabaseHelper::flushColumnarWriters()
+{
+    for (auto it = m_columnarWriters.begin(); it != m_columnarWriters.end(); ++it) {
+        if (!it->flush()) {
+            qDebug() << "写入列式文件失败:" << it.key();
+        }
+    }
+}
+
+bool DatabaseHelper::prepareInsertTick(const QString &table)
+{
+    m_insertTickQuery = QSqlQuery(m_db);
+    bool success = m_insertTickQuery.prepare(QString(
+        "INSERT INTO %1 (stock_code, name, price, prev_close, change, "
         "change_percent, open_price, volume, outer_disc, inner_disc, timestamp) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)").arg(table)
     );
 
-    query.addBindValue(stockCode);
-    query.addBindValue(name);
-    query.addBindValue(price);
-    query.addBindValue(prevClose);
-    query.addBindValue(change);
-    query.addBindValue(changePercent);
-    query.addBindValue(openPrice);
-    query.addBindValue(volume);
-    query.addBindValue(outerDisc);
-    query.addBindValue(innerDisc);
-    query.addBindValue(timestamp);
+    if (!success) {
+        qDebug() << "预编译语句失败:" << m_insertTickQuery.lastError().text();
+    }
+    return success;
+}
 
-    if (!query.exec()) {
-        qDebug() << "保存股票数据失败:" << query.lastError().text();
+bool DatabaseHelper::ensureWritePartition(qint64 timestamp)
+{
+    TickPartitions::Granularity granularity = (m_storageMode == WeeklyPartitions)
+                                              ? TickPartitions::Weekly : TickPartitions::Daily;
+    TickPartitions::Partition partition = TickPartitions::partitionFor(timestamp, granularity);
+    if (partition.key == m_currentPartition) {
+        return true;
+    }
+
+    // 卸载前释放引用旧分区的预编译语句
+    m_insertTickQuery = QSqlQuery();
+    if (!m_currentPartition.isEmpty()) {
+        detachDatabase(m_db, "cur");
+        m_currentPartition.clear();
+    }
+
+    if (!TickPartitions::registerPartition(m_db, partition)) {
+        return false;
+    }
+
+    if (partition.sealed) {
+        qDebug() << "分区已封存，丢弃写入:" << partition.key;
+        return false;
+    }
+
+    QString path = TickPartitions::filePath(partition.key);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    if (!attachDatabase(m_db, path, "cur")) {
         return false;
     }
 
+    {
+        QSqlQuery query(m_db);
+        if (!query.exec("PRAGMA cur.journal_mode=WAL")) {
+            qDebug() << "设置分区日志模式失败:" << query.lastError().text();
+        }
+    }
+
+    if (!createTickTable(m_db, "cur") || !prepareInsertTick("cur.stock_data")) {
+        m_insertTickQuery = QSqlQuery();
+        detachDatabase(m_db, "cur");
+        return false;
+    }
+
+    m_currentPartition = partition.key;
+
+    // 之前的分区不再写入，在后台封存
+    QString currentKey = m_currentPartition;
+    int compressAfterDays = m_compressAfterDays;
+    QThreadPool::globalInstance()->start(QRunnable::create([currentKey, compressAfterDays]() {
+        TickPartitions::sealPartitions(currentKey, compressAfterDays);
+    }));
+
+    return true;
+}
+
+bool DatabaseHelper::upsertBars(const QString &stockCode, double price, qint64 volume, qint64 timestamp)
+{
+    const qint64 utcOffsetMs = BarBuilder::localUtcOffsetMs();
+
+    for (int intervalSecs : barIntervals()) {
+        qint64 barTime = BarBuilder::alignTimestamp(timestamp, intervalSecs * 1000LL, utcOffsetMs);
+
+        m_upsertBarQuery.bindValue(0, stockCode);
+        m_upsertBarQuery.bindValue(1, intervalSecs);
+        m_upsertBarQuery.bindValue(2, barTime);
+        m_upsertBarQuery.bindValue(3, price);
+        m_upsertBarQuery.bindValue(4, price);
+        m_upsertBarQuery.bindValue(5, price);
+        m_upsertBarQuery.bindValue(6, price);
+        m_upsertBarQuery.bindValue(7, volume);
+
+        if (!m_upsertBarQuery.exec()) {
+            qDebug() << "更新K线失败:" << m_upsertBarQuery.lastError().text();
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -141,25 +517,226 @@ QList<QVariantMap> DatabaseHelper::getStockHistory(const QString &stockCode,
         return result;
     }
 
+    const int historyLimit = 150;
+    const qint64 fromMs = startTime.isValid() ? startTime.toMSecsSinceEpoch()
+                                              : std::numeric_limits<qint64>::min();
+    const qint64 toMs = endTime.isValid() ? endTime.toMSecsSinceEpoch()
+                                          : std::numeric_limits<qint64>::max();
+
+    // 列式文件从末尾的块向前取，只解码需要的块
+    if (m_storageMode == Columnar) {
+        ColumnarTickStore::Reader reader(ColumnarTickStore::filePath(stockCode));
+        for (int b = reader.lastBlockBefore(toMs); b >= 0 && result.size() < historyLimit; --b) {
+            const ColumnarTickStore::Block &block = reader.block(b);
+            if (block.lastTime < fromMs) {
+                break;
+            }
+
+            int count = int(qMin<quint32>(block.count, ColumnarTickStore::BlockCapacity));
+            for (int i = count - 1; i >= 0 && result.size() < historyLimit; --i) {
+                qint64 timestamp = block.time(i);
+                if (timestamp > toMs) {
+                    continue;
+                }
+                if (timestamp < fromMs) {
+                    break;
+                }
+
+                // 列式文件只保存时间、价格和成交量
+                QVariantMap record;
+                record["stock_code"] = stockCode;
+                record["price"] = block.price(i);
+                record["volume"] = block.volume[i];
+                record["timestamp"] = timestamp;
+                result.append(record);
+            }
+        }
+    } else {
+        // 从最新的表开始取，凑够条数即停止，分区模式下不会打开更早的分区
+        forEachTickTable(m_db, fromMs, toMs, true, [&](const QString &table) {
+            QSqlQuery query(m_db);
+
+            // 先获取最后150条数据（按时间戳降序）
+            query.prepare(QString("SELECT * FROM %1 WHERE stock_code = ? AND timestamp >= ? AND timestamp <= ? "
+                                  "ORDER BY timestamp DESC LIMIT ?").arg(table));
+            query.addBindValue(stockCode);
+            query.addBindValue(fromMs);
+            query.addBindValue(toMs);
+            query.addBindValue(historyLimit - result.size());
+
+            if (!query.exec()) {
+                qDebug() << "查询股票历史数据失败:" << query.lastError().text();
+                return true;
+            }
+
+            // 先存储结果，然后按时间戳升序排列
+            while (query.next()) {
+                QVariantMap record;
+                record["id"] = query.value("id");
+                record["stock_code"] = query.value("stock_code");
+                record["name"] = query.value("name");
+                record["price"] = query.value("price");
+                record["prev_close"] = query.value("prev_close");
+                record["change"] = query.value("change");
+                record["change_percent"] = query.value("change_percent");
+                record["open_price"] = query.value("open_price");
+                record["volume"] = query.value("volume");
+                record["outer_disc"] = query.value("outer_disc");
+                record["inner_disc"] = query.value("inner_disc");
+                record["timestamp"] = query.value("timestamp");
+
+                result.append(record);
+            }
+
+            return result.size() < historyLimit;
+        }, [&](const QString &archive) {
+            // 压缩分区直接解码归档中这只股票的数据
+            TickRows rows;
+            if (!TickArchive::readRows(archive, stockCode, rows)) {
+                qDebug() << "读取归档失败:" << archive;
+                return true;
+            }
+
+            const int first = rows.lowerBound(fromMs);
+            for (int i = rows.upperBound(toMs) - 1; i >= first && result.size() < historyLimit; --i) {
+                QVariantMap record;
+                record["stock_code"] = stockCode;
+                record["name"] = rows.name;
+                record["price"] = TickCodec::fromFixed(rows.prices.at(i));
+                record["prev_close"] = TickCodec::fromFixed(rows.prevCloses.at(i));
+                record["change"] = rows.change(i);
+                record["change_percent"] = rows.changePercent(i);
+                record["open_price"] = TickCodec::fromFixed(rows.openPrices.at(i));
+                record["volume"] = QString::number(rows.volumes.at(i));
+                record["outer_disc"] = QString::number(rows.outerDiscs.at(i));
+                record["inner_disc"] = QString::number(rows.innerDiscs.at(i));
+                record["timestamp"] = rows.timestamps.at(i);
+                result.append(record);
+            }
+
+            return result.size() < historyLimit;
+        }, m_currentPartition);
+    }
+
+    // 按时间戳升序排列（从旧到新）
+    std::sort(result.begin(), result.end(), [](const QVariantMap &a, const QVariantMap &b) {
+        return a["timestamp"].toLongLong() < b["timestamp"].toLongLong();
+    });
+
+    return result;
+}
+
+BarSeries DatabaseHelper::getStockBars(const QString &stockCode, int intervalSecs,
+                                      const QDateTime &startTime,
+                                      const QDateTime &endTime)
+{
+    BarSeries result;
+
+    if (intervalSecs <= 0 || (!m_initialized && !initializeDatabase())) {
+        return result;
+    }
+
+    // 周期是物化周期的整数倍时直接读取预聚合K线，取能整除的最大周期
+    int baseIntervalSecs = 0;
+    for (int materialized : barIntervals()) {
+        if (intervalSecs % materialized == 0) {
+            baseIntervalSecs = materialized;
+        }
+    }
+
+    if (baseIntervalSecs > 0) {
+        return loadMaterializedBars(stockCode, intervalSecs, baseIntervalSecs, startTime, endTime);
+    }
+
+    const qint64 fromMs = startTime.isValid() ? startTime.toMSecsSinceEpoch()
+                                              : std::numeric_limits<qint64>::min();
+    const qint64 toMs = endTime.isValid() ? endTime.toMSecsSinceEpoch()
+                                          : std::numeric_limits<qint64>::max();
+
+    BarBuilder builder(static_cast<qint64>(intervalSecs) * 1000, BarBuilder::localUtcOffsetMs());
+
+    auto addTick = [&](qint64 timestamp, double price, qint64 volume) {
+        if (builder.addTick(timestamp, price, volume) == BarBuilder::NewBar
+            && builder.hasClosedBar()) {
+            result.append(builder.lastClosedBar());
+        }
+    };
+
+    // 列式文件直接在映射内存上扫描
+    if (m_storageMode == Columnar) {
+        ColumnarTickStore::Reader reader(ColumnarTickStore::filePath(stockCode));
+        reader.forEachTick(fromMs, toMs, addTick);
+    } else {
+        // 只取聚合所需的三列，沿联合索引按时间顺序单次扫描
+        forEachTickTable(m_db, fromMs, toMs, false, [&](const QString &table) {
+            QSqlQuery query(m_db);
+            query.setForwardOnly(true);
+            query.prepare(QString("SELECT timestamp, price, volume FROM %1 "
+                                  "WHERE stock_code = ? AND timestamp >= ? AND timestamp <= ? "
+                                  "ORDER BY timestamp").arg(table));
+            query.addBindValue(stockCode);
+            query.addBindValue(fromMs);
+            query.addBindValue(toMs);
+
+            if (!query.exec()) {
+                qDebug() << "查询K线数据失败:" << query.lastError().text();
+                return true;
+            }
+
+            while (query.next()) {
+                addTick(query.value(0).toLongLong(), query.value(1).toDouble(), query.value(2).toLongLong());
+            }
+            return true;
+        }, [&](const QString &archive) {
+            TickRows rows;
+            if (!TickArchive::readRows(archive, stockCode, rows)) {
+                qDebug() << "读取归档失败:" << archive;
+                return true;
+            }
+            rows.forEachTick(fromMs, toMs, addTick);
+            return true;
+        }, m_currentPartition);
+    }
+
+    if (builder.hasBar()) {
+        result.append(builder.currentBar());
+    }
+
+    return result;
+}
+
+BarSeries DatabaseHelper::loadMaterializedBars(const QString &stockCode, int intervalSecs,
+                                               int baseIntervalSecs,
+                                               const QDateTime &startTime,
+                                               const QDateTime &endTime)
+{
+    BarSeries result;
+
+    const qint64 intervalMs = intervalSecs * 1000LL;
+    const qint64 utcOffsetMs = BarBuilder::localUtcOffsetMs();
+
     QSqlQuery query;
-    QString sql = "SELECT * FROM stock_data WHERE stock_code = ?";
+    query.setForwardOnly(true);
+    QString sql = "SELECT bar_time, open, high, low, close, volume FROM stock_bars "
+                  "WHERE stock_code = ? AND interval_sec = ?";
 
     if (startTime.isValid()) {
-        sql += " AND timestamp >= ?";
+        sql += " AND bar_time >= ?";
     }
 
     if (endTime.isValid()) {
-        sql += " AND timestamp <= ?";
+        sql += " AND bar_time <= ?";
     }
 
-    // 先获取最后100条数据（按时间戳降序）
-    sql += " ORDER BY timestamp DESC LIMIT 150";
+    sql += " ORDER BY bar_time";
 
     query.prepare(sql);
     query.addBindValue(stockCode);
+    query.addBindValue(baseIntervalSecs);
 
+    // 起始时间所在的合并后K线要完整包含在内，按目标周期对齐
     if (startTime.isValid()) {
-        query.addBindValue(startTime.toMSecsSinceEpoch());
+        query.addBindValue(BarBuilder::alignTimestamp(startTime.toMSecsSinceEpoch(), intervalMs, utcOffsetMs));
     }
 
     if (endTime.isValid()) {
@@ -167,33 +744,44 @@ QList<QVariantMap> DatabaseHelper::getStockHistory(const QString &stockCode,
     }
 
     if (!query.exec()) {
-        qDebug() << "查询股票历史数据失败:" << query.lastError().text();
+        qDebug() << "查询K线数据失败:" << query.lastError().text();
         return result;
     }
 
-    // 先存储结果，然后按时间戳升序排列
+    StockBar bar;
+    bool hasBar = false;
     while (query.next()) {
-        QVariantMap record;
-        record["id"] = query.value("id");
-        record["stock_code"] = query.value("stock_code");
-        record["name"] = query.value("name");
-        record["price"] = query.value("price");
-        record["prev_close"] = query.value("prev_close");
-        record["change"] = query.value("change");
-        record["change_percent"] = query.value("change_percent");
-        record["open_price"] = query.value("open_price");
-        record["volume"] = query.value("volume");
-        record["outer_disc"] = query.value("outer_disc");
-        record["inner_disc"] = query.value("inner_disc");
-        record["timestamp"] = query.value("timestamp");
-
-        result.append(record);
+        qint64 barTime = BarBuilder::alignTimestamp(query.value(0).toLongLong(), intervalMs, utcOffsetMs);
+        double open = query.value(1).toDouble();
+        double high = query.value(2).toDouble();
+        double low = query.value(3).toDouble();
+        double close = query.value(4).toDouble();
+        qint64 volume = query.value(5).toLongLong();
+
+        if (hasBar && barTime == bar.time) {
+            bar.high = qMax(bar.high, high);
+            bar.low = qMin(bar.low, low);
+            bar.close = close;
+            bar.volume += volume;
+            continue;
+        }
+
+        if (hasBar) {
+            result.append(bar);
+        }
+
+        bar.time = barTime;
+        bar.open = open;
+        bar.high = high;
+        bar.low = low;
+        bar.close = close;
+        bar.volume = volume;
+        hasBar = true;
     }
 
-    // 按时间戳升序排列（从旧到新）
-    std::sort(result.begin(), result.end(), [](const QVariantMap &a, const QVariantMap &b) {
-        return a["timestamp"].toLongLong() < b["timestamp"].toLongLong();
-    });
+    if (hasBar) {
+        result.append(bar);
+    }
 
     return result;
 }
@@ -206,12 +794,449 @@ QStringList DatabaseHelper::getAllStockCodes()
         return result;
     }
 
-    QSqlQuery query;
-    query.exec("SELECT DISTINCT stock_code FROM stock_data ORDER BY stock_code");
+    if (m_storageMode == Columnar) {
+        return ColumnarTickStore::stockCodes();
+    }
+
+    // 合并所有tick表中的股票代码
+    QSet<QString> codes;
+    forEachTickTable(m_db, std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max(), false,
+                     [&](const QString &table) {
+        const QStringList tableCodes = listStockCodes(m_db, table);
+        for (const QString &code : tableCodes) {
+            codes.insert(code);
+        }
+        return true;
+    }, [&](const QString &archive) {
+        const QStringList archiveCodes = TickArchive::stockCodes(archive);
+        for (const QString &code : archiveCodes) {
+            codes.insert(code);
+        }
+        return true;
+    }, m_currentPartition);
+
+    result = codes.values();
+    std::sort(result.begin(), result.end());
+
+    return result;
+}
+
+int DatabaseHelper::rebuildBars(const QStringList &stockCodes)
+{
+    if (!m_initialized && !initializeDatabase()) {
+        return 0;
+    }
+
+    const int count = rebuildBarsForSymbols(stockCodes.isEmpty() ? getAllStockCodes() : stockCodes);
+    resetBarBaseline();
+    return count;
+}
+
+int DatabaseHelper::rebuildBarsForSymbols(const QStringList &stockCodes,
+                                          const std::function<void(int, int)> &progress)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // 每只股票一个任务，各自使用独立连接读取与写入
+    const int total = stockCodes.size();
+    QAtomicInt rebuilt(0);
+    QAtomicInt finished(0);
+    QThreadPool pool;
+    for (const QString &code : stockCodes) {
+        pool.start(QRunnable::create([code, total, &rebuilt, &finished, &progress]() {
+            if (rebuildBarsForSymbol(code)) {
+                rebuilt.ref();
+            }
+            const int done = finished.fetchAndAddOrdered(1) + 1;
+            if (progress) {
+                progress(done, total);
+            }
+        }));
+    }
+    pool.waitForDone();
+
+    qDebug() << "重建K线完成:" << rebuilt.loadAcquire() << "/" << total
+             << "只股票, 耗时" << timer.elapsed() << "ms";
+
+    return rebuilt.loadAcquire();
+}
+
+void DatabaseHelper::resetBarBaseline()
+{
+    // 下一笔重新从最后保存的tick取基准
+    m_lastVolumes.clear();
+    m_needsBarRebuild = false;
+}
+
+int DatabaseHelper::convertToColumnar()
+{
+    if (!m_initialized && !initializeDatabase()) {
+        return 0;
+    }
+
+    // 列式模式下的新tick只在列式文件中，重新生成会丢失这部分数据
+    if (m_storageMode == Columnar) {
+        qDebug() << "已是列式存储，请在切换存储方式之前转换";
+        return 0;
+    }
+
+    return ColumnarTickStore::convertFromDatabase(m_db, m_currentPartition);
+}
+
+bool DatabaseHelper::exportTicks(const QString &fileName)
+{
+    if (!m_initialized && !initializeDatabase()) {
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    TickArchive::Writer writer(fileName);
+    if (!writer.isOpen()) {
+        return false;
+    }
+
+    // 逐只股票读取并编码，内存中只保留一只股票的数据
+    const QStringList codes = getAllStockCodes();
+    for (const QString &code : codes) {
+        TickRows rows;
+        rows.stockCode = code;
+
+        bool success = true;
+        if (m_storageMode == Columnar) {
+            // 列式文件只有时间、价格和成交量
+            ColumnarTickStore::Reader reader(ColumnarTickStore::filePath(code));
+            reader.forEachTick(std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max(),
+                               [&](qint64 timestamp, double price, qint64 volume) {
+                rows.append(timestamp, price, 0.0, 0.0, volume, 0, 0);
+            });
+        } else {
+            forEachTickTable(m_db, std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max(), false,
+                             [&](const QString &table) {
+                success = TickArchive::readRows(m_db, table, code, rows);
+                return success;
+            }, [&](const QString &archive) {
+                success = TickArchive::readRows(archive, code, rows);
+                return success;
+            }, m_currentPartition);
+        }
+
+        if (!success || !writer.add(rows)) {
+            return false;
+        }
+    }
+
+    if (!writer.finish()) {
+        return false;
+    }
+
+    qDebug() << "导出tick:" << codes.size() << "只股票," << writer.rowCount() << "笔,"
+             << QFileInfo(fileName).size() << "字节, 耗时" << timer.elapsed() << "ms";
+    return true;
+}
+
+bool DatabaseHelper::rebuildBarsForSymbol(const QString &stockCode)
+{
+    Connection connection(QString("rebuild_bars_%1").arg(stockCode));
+    if (!connection.isOpen()) {
+        return false;
+    }
+
+    QSqlDatabase db = connection.database();
+
+    QVector<QVector<StockBar>> bars;
+    if (!aggregateTicks(db, stockCode, std::numeric_limits<qint64>::min(),
+                        std::numeric_limits<qint64>::max(), bars)) {
+        return false;
+    }
+
+    // 先读后写，读游标已释放，写事务只持有很短时间
+    if (!db.transaction()) {
+        qDebug() << "开启事务失败:" << stockCode << db.lastError().text();
+        return false;
+    }
+
+    bool success = true;
+    {
+        QSqlQuery query(db);
+        query.prepare("DELETE FROM stock_bars WHERE stock_code = ?");
+        query.addBindValue(stockCode);
+        success = query.exec();
+    }
+
+    if (!success || !writeBars(db, stockCode, bars, true) || !db.commit()) {
+        db.rollback();
+        return false;
+    }
+
+    return true;
+}
+
+bool DatabaseHelper::aggregateTicks(QSqlDatabase &db, const QString &stockCode,
+                                    qint64 fromMs, qint64 toMs,
+                                    QVector<QVector<StockBar>> &bars,
+                                    const QString &table)
+{
+    BarAggregator aggregator(bars);
+    auto addTick = [&](qint64 timestamp, double price, qint64 volume) {
+        aggregator.addTick(timestamp, price, volume);
+    };
+
+    bool success = true;
+    auto scan = [&](const QString &tickTable) {
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        query.prepare(QString("SELECT timestamp, price, volume FROM %1 "
+                              "WHERE stock_code = ? AND timestamp >= ? AND timestamp < ? "
+                              "ORDER BY timestamp").arg(tickTable));
+        query.addBindValue(stockCode);
+        query.addBindValue(fromMs);
+        query.addBindValue(toMs);
+
+        if (!query.exec()) {
+            qDebug() << "读取tick失败:" << stockCode << query.lastError().text();
+            success = false;
+            return false;
+        }
+
+        while (query.next()) {
+            addTick(query.value(0).toLongLong(), query.value(1).toDouble(), query.value(2).toLongLong());
+        }
+        return true;
+    };
+
+    auto scanArchive = [&](const QString &archive) {
+        TickRows rows;
+        if (!TickArchive::readRows(archive, stockCode, rows)) {
+            qDebug() << "读取归档失败:" << stockCode << archive;
+            success = false;
+            return false;
+        }
+        rows.forEachTick(fromMs, toMs - 1, addTick);
+        return true;
+    };
+
+    if (!table.isEmpty()) {
+        scan(table);
+    } else if (instance().storageMode() == Columnar) {
+        ColumnarTickStore::Reader reader(ColumnarTickStore::filePath(stockCode));
+        reader.forEachTick(fromMs, toMs - 1, addTick);
+    } else {
+        forEachTickTable(db, fromMs, toMs, false, scan, scanArchive);
+    }
+
+    if (!success) {
+        return false;
+    }
+
+    aggregator.finish();
+    return true;
+}
+
+void DatabaseHelper::aggregateTicks(const TickRows &rows, qint64 fromMs, qint64 toMs,
+                                    QVector<QVector<StockBar>> &bars)
+{
+    BarAggregator aggregator(bars);
+    rows.forEachTick(fromMs, toMs - 1, [&](qint64 timestamp, double price, qint64 volume) {
+        aggregator.addTick(timestamp, price, volume);
+    });
+    aggregator.finish();
+}
+
+bool DatabaseHelper::writeBars(QSqlDatabase &db, const QString &stockCode,
+                               const QVector<QVector<StockBar>> &bars, bool replaceExisting)
+{
+    QSqlQuery insert(db);
+    insert.prepare(QString("INSERT OR %1 INTO stock_bars (stock_code, interval_sec, bar_time, "
+                           "open, high, low, close, volume) VALUES (?, ?, ?, ?, ?, ?, ?, ?)")
+                   .arg(replaceExisting ? "REPLACE" : "IGNORE"));
+
+    for (int i = 0; i < bars.size() && i < barIntervals().size(); ++i) {
+        for (const StockBar &bar : bars[i]) {
+            insert.bindValue(0, stockCode);
+            insert.bindValue(1, barIntervals().at(i));
+            insert.bindValue(2, bar.time);
+            insert.bindValue(3, bar.open);
+            insert.bindValue(4, bar.high);
+            insert.bindValue(5, bar.low);
+            insert.bindValue(6, bar.close);
+            insert.bindValue(7, bar.volume);
+            if (!insert.exec()) {
+                qDebug() << "写入K线失败:" << stockCode << insert.lastError().text();
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool DatabaseHelper::attachDatabase(QSqlDatabase &db, const QString &path, const QString &alias, bool readOnly)
+{
+    QSqlQuery query(db);
+    query.prepare(QString("ATTACH DATABASE ? AS %1").arg(alias));
+    if (readOnly) {
+        // URI中的路径须转义，mode=ro时SQLite拒绝任何写入
+        query.addBindValue(QUrl::fromLocalFile(path).toString(QUrl::FullyEncoded) + "?mode=ro");
+    } else {
+        query.addBindValue(path);
+    }
+
+    if (!query.exec()) {
+        qDebug() << "挂载数据库失败:" << path << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void DatabaseHelper::detachDatabase(QSqlDatabase &db, const QString &alias)
+{
+    QSqlQuery query(db);
+    if (!query.exec(QString("DETACH DATABASE %1").arg(alias))) {
+        qDebug() << "卸载数据库失败:" << alias << query.lastError().text();
+    }
+}
+
+bool DatabaseHelper::createTickTable(QSqlDatabase &db, const QString &schema)
+{
+    QSqlQuery query(db);
+    bool success = query.exec(QString(
+        "CREATE TABLE IF NOT EXISTS %1.stock_data ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "stock_code TEXT NOT NULL, "
+        "name TEXT NOT NULL, "
+        "price REAL NOT NULL, "
+        "prev_close REAL NOT NULL, "
+        "change REAL NOT NULL, "
+        "change_percent REAL NOT NULL, "
+        "open_price REAL NOT NULL, "
+        "volume TEXT, "
+        "outer_disc TEXT, "
+        "inner_disc TEXT, "
+        "timestamp DATETIME DEFAULT CURRENT_TIMESTAMP"
+        ")").arg(schema)
+    );
+
+    if (!success) {
+        qDebug() << "创建表失败:" << query.lastError().text();
+        return false;
+    }
+
+    // 创建代码+时间联合索引，单只股票的时间范围扫描无需再排序
+    success = query.exec(QString("CREATE INDEX IF NOT EXISTS %1.idx_stock_code_timestamp "
+                                 "ON stock_data(stock_code, timestamp)").arg(schema));
+    if (!success) {
+        qDebug() << "创建索引失败:" << query.lastError().text();
+        return false;
+    }
+
+    // 创建时间戳索引，预加载历史按时间段跨股票扫描，分区文件中也需要
+    success = query.exec(QString("CREATE INDEX IF NOT EXISTS %1.idx_timestamp "
+                                 "ON stock_data(timestamp)").arg(schema));
+    if (!success) {
+        qDebug() << "创建索引失败:" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+QStringList DatabaseHelper::listStockCodes(QSqlDatabase &db, const QString &table)
+{
+    QStringList codes;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    bool success = query.exec(QString(
+        "WITH RECURSIVE codes(code) AS ("
+        "SELECT MIN(stock_code) FROM %1 "
+        "UNION ALL "
+        "SELECT (SELECT MIN(stock_code) FROM %1 WHERE stock_code > code) "
+        "FROM codes WHERE code IS NOT NULL"
+        ") SELECT code FROM codes WHERE code IS NOT NULL").arg(table)
+    );
+
+    if (!success) {
+        qDebug() << "获取股票列表失败:" << query.lastError().text();
+        return codes;
+    }
 
     while (query.next()) {
-        result.append(query.value(0).toString());
+        codes.append(query.value(0).toString());
     }
+    return codes;
+}
 
-    return result;
+void DatabaseHelper::forEachTickTable(QSqlDatabase &db, qint64 fromMs, qint64 toMs, bool newestFirst,
+                                      const std::function<bool(const QString &table)> &visitor,
+                                      const std::function<bool(const QString &archivePath)> &archiveVisitor,
+                                      const QString &attachedKey)
+{
+    if (instance().storageMode() == SingleFile) {
+        visitor("main.stock_data");
+        return;
+    }
+
+    // 主库中是切换到分区模式之前的数据，早于所有分区
+    if (!newestFirst && !visitor("main.stock_data")) {
+        return;
+    }
+
+    const QList<TickPartitions::Partition> partitions = TickPartitions::overlapping(db, fromMs, toMs, newestFirst);
+    for (const TickPartitions::Partition &partition : partitions) {
+        if (!attachedKey.isEmpty() && partition.key == attachedKey) {
+            if (!visitor("cur.stock_data")) {
+                return;
+            }
+            continue;
+        }
+
+        // 压缩分区不还原为SQLite，由调用方直接解码归档
+        if (partition.compressed) {
+            QString archive = TickPartitions::archivePath(partition);
+            if (!archive.isEmpty() && !archiveVisitor(archive)) {
+                return;
+            }
+            continue;
+        }
+
+        QString path = TickPartitions::openablePath(partition);
+        if (path.isEmpty() || !attachDatabase(db, path, "part", partition.sealed)) {
+            continue;
+        }
+
+        bool keepGoing = visitor("part.stock_data");
+        detachDatabase(db, "part");
+        if (!keepGoing) {
+            return;
+        }
+    }
+
+    if (newestFirst) {
+        visitor("main.stock_data");
+    }
+}
+
+DatabaseHelper::Connection::Connection(const QString &connectionName, const QString &databasePath)
+    : m_connectionName(connectionName)
+{
+    m_db = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+    m_db.setDatabaseName(databasePath.isEmpty() ? DatabaseHelper::instance().databasePath() : databasePath);
+    m_db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=30000;QSQLITE_OPEN_URI");
+
+    if (!m_db.open()) {
+        qDebug() << "无法打开数据库连接:" << m_connectionName << m_db.lastError().text();
+    }
+}
+
+DatabaseHelper::Connection::~Connection()
+{
+    if (m_db.isOpen()) {
+        m_db.close();
+    }
+
+    // 移除连接前必须释放所有引用
+    m_db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(m_connectionName);
 }
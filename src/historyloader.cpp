@@ -0,0 +1,239 @@
+#include "historyloader.h"
+#include "databasehelper.h"
+#include "columnartickstore.h"
+#include "tickcodec.h"
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// 并行扫描的最大段数
+const int MaxSlices = 8;
+
+// 保留序列末尾的maxPoints个点
+void keepTail(TickSeries &series, int maxPoints)
+{
+    int excess = series.size() - maxPoints;
+    if (excess > 0) {
+        series.keys.remove(0, excess);
+        series.values.remove(0, excess);
+    }
+}
+
+} // namespace
+
+HistoryLoader::HistoryLoader(QObject *parent)
+    : QObject(parent)
+    , m_windowMs(30 * 60 * 1000)
+    , m_maxPoints(150)
+    , m_budgetMs(100)
+    , m_complete(false)
+    , m_rowCount(0)
+{
+}
+
+QHash<QString, TickSeries> HistoryLoader::load(const QStringList &stockCodes)
+{
+    QHash<QString, TickSeries> result;
+    m_complete = false;
+    m_rowCount = 0;
+
+    if (stockCodes.isEmpty() || !DatabaseHelper::instance().initializeDatabase()) {
+        return result;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const bool columnar = DatabaseHelper::instance().storageMode() == DatabaseHelper::Columnar;
+    const int sliceCount = qBound(1, QThread::idealThreadCount(), MaxSlices);
+    const qint64 toMs = QDateTime::currentMSecsSinceEpoch() + 1;
+    const qint64 fromMs = toMs - m_windowMs;
+
+    // SQLite按时间切段，列式文件按股票切段
+    QVector<Slice> slices(sliceCount);
+    for (int i = 0; i < sliceCount; ++i) {
+        Slice &slice = slices[i];
+        slice.index = i;
+        slice.fromMs = fromMs + m_windowMs * i / sliceCount;
+        slice.toMs = (i == sliceCount - 1) ? toMs : fromMs + m_windowMs * (i + 1) / sliceCount;
+    }
+    if (columnar) {
+        for (Slice &slice : slices) {
+            slice.fromMs = fromMs;
+            slice.toMs = toMs;
+        }
+        for (int i = 0; i < stockCodes.size(); ++i) {
+            slices[i % sliceCount].stockCodes.append(stockCodes.at(i));
+        }
+    }
+
+    const QSet<QString> codes(stockCodes.begin(), stockCodes.end());
+    const int maxPoints = m_maxPoints;
+    QAtomicInt cancel(0);
+    QSemaphore finished;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(sliceCount);
+    for (Slice &slice : slices) {
+        Slice *target = &slice;
+        pool.start(QRunnable::create([target, &codes, maxPoints, &cancel, &finished, columnar]() {
+            if (columnar) {
+                readColumnarSlice(*target, maxPoints, cancel);
+            } else {
+                scanSlice(*target, codes, maxPoints, cancel);
+            }
+            finished.release();
+        }));
+    }
+
+    // 在调用线程中等待各段完成并报告进度，超出预算时通知各段停止
+    int done = 0;
+    while (done < sliceCount) {
+        int remaining = qMax(0, m_budgetMs - int(timer.elapsed()));
+        if (!finished.tryAcquire(1, remaining)) {
+            cancel.storeRelease(1);
+            break;
+        }
+        ++done;
+        emit progress(done, sliceCount);
+    }
+    pool.waitForDone();
+    m_complete = (done == sliceCount);
+
+    // 各段时间不重叠，按时间顺序拼接；列式模式下各段股票不重叠
+    for (const Slice &slice : slices) {
+        m_rowCount += slice.rows;
+        for (auto it = slice.series.constBegin(); it != slice.series.constEnd(); ++it) {
+            TickSeries &series = result[it.key()];
+            for (int i = 0; i < it->size(); ++i) {
+                if (series.isEmpty() || it->keys.at(i) > series.keys.last()) {
+                    series.keys.append(it->keys.at(i));
+                    series.values.append(it->values.at(i));
+                }
+            }
+        }
+    }
+
+    for (auto it = result.begin(); it != result.end(); ++it) {
+        keepTail(it.value(), maxPoints);
+    }
+
+    qDebug() << "预加载历史:" << result.size() << "只股票," << m_rowCount << "行,"
+             << sliceCount << "段, 耗时" << timer.elapsed() << "ms"
+             << (m_complete ? "" : "(超出预算，已截断)");
+
+    return result;
+}
+
+void HistoryLoader::scanSlice(Slice &slice, const QSet<QString> &codes, int maxPoints, const QAtomicInt &cancel)
+{
+    const QString connectionName = QString("history_%1_%2")
+                                   .arg(reinterpret_cast<quintptr>(QThread::currentThreadId()))
+                                   .arg(slice.index);
+    DatabaseHelper::Connection connection(connectionName);
+    if (!connection.isOpen()) {
+        return;
+    }
+
+    QSqlDatabase db = connection.database();
+
+    // 沿时间索引倒序扫描，被截断时保留的是最新的数据
+    DatabaseHelper::forEachTickTable(db, slice.fromMs, slice.toMs - 1, true, [&](const QString &table) {
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        query.prepare(QString("SELECT stock_code, timestamp, price FROM %1 "
+                              "WHERE timestamp >= ? AND timestamp < ? ORDER BY timestamp DESC").arg(table));
+        query.addBindValue(slice.fromMs);
+        query.addBindValue(slice.toMs);
+
+        if (!query.exec()) {
+            qDebug() << "预加载历史失败:" << query.lastError().text();
+            return true;
+        }
+
+        while (query.next()) {
+            if (cancel.loadAcquire()) {
+                return false;
+            }
+
+            ++slice.rows;
+            const QString code = query.value(0).toString();
+            if (!codes.contains(code)) {
+                continue;
+            }
+
+            TickSeries &series = slice.series[code];
+            if (series.size() < maxPoints) {
+                series.keys.append(query.value(1).toLongLong() / 1000.0);
+                series.values.append(query.value(2).toDouble());
+            }
+        }
+        return true;
+    }, [&](const QString &archive) {
+        // 压缩分区按股票分段，只解码需要的股票，同样从新到旧取
+        TickArchive::Reader reader(archive);
+        QString code;
+        TickRows rows;
+        while (reader.nextCode(code)) {
+            if (cancel.loadAcquire()) {
+                return false;
+            }
+            if (!codes.contains(code)) {
+                reader.skip();
+                continue;
+            }
+            if (!reader.read(rows)) {
+                break;
+            }
+
+            const int first = rows.lowerBound(slice.fromMs);
+            const int last = rows.lowerBound(slice.toMs);
+            if (first >= last) {
+                continue;
+            }
+            slice.rows += last - first;
+
+            TickSeries &series = slice.series[code];
+            for (int i = last - 1; i >= first && series.size() < maxPoints; --i) {
+                series.keys.append(rows.timestamps.at(i) / 1000.0);
+                series.values.append(TickCodec::fromFixed(rows.prices.at(i)));
+            }
+        }
+        return true;
+    });
+
+    for (auto it = slice.series.begin(); it != slice.series.end(); ++it) {
+        std::reverse(it->keys.begin(), it->keys.end());
+        std::reverse(it->values.begin(), it->values.end());
+    }
+}
+
+void HistoryLoader::readColumnarSlice(Slice &slice, int maxPoints, const QAtomicInt &cancel)
+{
+    for (const QString &code : qAsConst(slice.stockCodes)) {
+        if (cancel.loadAcquire()) {
+            return;
+        }
+
+        ColumnarTickStore::Reader reader(ColumnarTickStore::filePath(code));
+        if (!reader.isOpen()) {
+            continue;
+        }
+
+        TickSeries series;
+        slice.rows += reader.readSeries(slice.fromMs, slice.toMs - 1, series.keys, series.values);
+        keepTail(series, maxPoints);
+        if (!series.isEmpty()) {
+            slice.series.insert(code, series);
+        }
+    }
+}
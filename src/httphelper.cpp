@@ -1,6 +1,7 @@
 
 #include "httphelper.h"
 #include "databasehelper.h"
+#include "numberformatter.h"
 #include <QDebug>
 
 HttpHelper::HttpHelper(QObject *parent)
@@ -66,19 +67,31 @@ QString HttpHelper::parseSinaData(const QString &rawData, const QString &stockCo
     double changePercent = items[34].toDouble();
     qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
 
-    // 格式化结果
-    // 返回：名称|当前价|涨跌额|涨跌幅|昨收价|开盘价|成交量|外盘|内盘
-    return QString("%1|%2|%3|%4|%5|%6|%7|%8|%9|%10")
-           .arg(name)
-           .arg(price, 0, 'f', 2)
-           .arg(change, 0, 'f', 2)
-           .arg(changePercent, 0, 'f', 2)
-           .arg(prevClose, 0, 'f', 2)
-           .arg(items[5].toDouble(), 0, 'f', 2)  // 开盘价
-           .arg(items[6])  // 成交量
-           .arg(items[7])  // 外盘
-           .arg(items[8])  // 内盘
-           .arg(timestamp);
+    // 格式化结果，逐段追加到预留好空间的字符串，不经过QString::arg的多次替换
+    // 返回：名称|当前价|涨跌额|涨跌幅|昨收价|开盘价|成交量|外盘|内盘|时间戳
+    QChar buffer[NumberFormatter::BufferSize];
+    QString result;
+    result.reserve(128);
+    result += name;
+    result += QLatin1Char('|');
+    result.append(buffer, NumberFormatter::formatFixed(price, 2, buffer));
+    result += QLatin1Char('|');
+    result.append(buffer, NumberFormatter::formatFixed(change, 2, buffer));
+    result += QLatin1Char('|');
+    result.append(buffer, NumberFormatter::formatFixed(changePercent, 2, buffer));
+    result += QLatin1Char('|');
+    result.append(buffer, NumberFormatter::formatFixed(prevClose, 2, buffer));
+    result += QLatin1Char('|');
+    result.append(buffer, NumberFormatter::formatFixed(items[5].toDouble(), 2, buffer));  // 开盘价
+    result += QLatin1Char('|');
+    result += items[6];  // 成交量
+    result += QLatin1Char('|');
+    result += items[7];  // 外盘
+    result += QLatin1Char('|');
+    result += items[8];  // 内盘
+    result += QLatin1Char('|');
+    result.append(buffer, NumberFormatter::formatInteger(timestamp, buffer));
+    return result;
 }
 
 QJsonObject HttpHelper::parseJsonData(const QString &jsonData)
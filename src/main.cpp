@@ -1,13 +1,112 @@
-
 #include <QApplication>
+#include <QCommandLineParser>
 #include "mainwindow.h"
+#include "databasehelper.h"
+#include "startupprofiler.h"
+#include "chartbenchmark.h"
+#include "numberformatter.h"
+#include "quotetablemodel.h"
+#include "thememanager.h"
 
 int main(int argc, char *argv[])
 {
+    StartupProfiler::start();
+
+    // 软件OpenGL（Mesa llvmpipe）需要在创建QApplication之前选择
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--software-opengl") == 0) {
+            QCoreApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
+            qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+        }
+    }
+
     QApplication app(argc, argv);
+    StartupProfiler::mark("QApplication");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption rebuildBarsOption("rebuild-bars", "从原始tick重建K线物化表后退出");
+    parser.addOption(rebuildBarsOption);
+    QCommandLineOption storageOption("storage", "设置tick存储方式：single（单文件）、daily（按日分区）、weekly（按周分区）、columnar（列式文件）", "mode");
+    parser.addOption(storageOption);
+    QCommandLineOption convertColumnarOption("convert-columnar", "把已有tick转换为列式文件后退出");
+    parser.addOption(convertColumnarOption);
+    QCommandLineOption exportTicksOption("export-ticks", "把全部tick导出为压缩归档文件后退出", "file");
+    parser.addOption(exportTicksOption);
+    QCommandLineOption softwareOpenGlOption("software-opengl", "没有可用显卡时使用软件实现的OpenGL");
+    parser.addOption(softwareOpenGlOption);
+    QCommandLineOption benchChartOption("bench-chart", "测试指定点数的图表绘制帧率后退出", "points");
+    parser.addOption(benchChartOption);
+    QCommandLineOption benchChartUpdateOption("bench-chart-update", "对比指定点数的分时图增量更新与整体重设的耗时后退出", "points");
+    parser.addOption(benchChartUpdateOption);
+    QCommandLineOption benchFormatOption("bench-format", "对比指定次数的数字格式化耗时后退出", "count");
+    parser.addOption(benchFormatOption);
+    QCommandLineOption benchTableOption("bench-table", "测试指定行数的表格排序更新耗时后退出", "rows");
+    parser.addOption(benchTableOption);
+    QCommandLineOption benchThemeOption("bench-theme", "对比指定次数的主题切换耗时后退出", "count");
+    parser.addOption(benchThemeOption);
+    parser.process(app);
+
+    // 存储方式在数据库初始化前写入配置，本次启动即生效
+    if (parser.isSet(storageOption)) {
+        QString mode = parser.value(storageOption);
+        if (mode == "single") {
+            DatabaseHelper::saveStorageMode(DatabaseHelper::SingleFile);
+        } else if (mode == "daily") {
+            DatabaseHelper::saveStorageMode(DatabaseHelper::DailyPartitions);
+        } else if (mode == "weekly") {
+            DatabaseHelper::saveStorageMode(DatabaseHelper::WeeklyPartitions);
+        } else if (mode == "columnar") {
+            DatabaseHelper::saveStorageMode(DatabaseHelper::Columnar);
+        } else {
+            qWarning() << "未知的存储方式:" << mode;
+            return 1;
+        }
+    }
+
+    // 命令行维护模式：不显示窗口
+    if (parser.isSet(rebuildBarsOption)) {
+        int count = DatabaseHelper::instance().rebuildBars();
+        qInfo() << "已重建K线:" << count << "只股票";
+        return 0;
+    }
+
+    if (parser.isSet(convertColumnarOption)) {
+        int count = DatabaseHelper::instance().convertToColumnar();
+        qInfo() << "已转换列式存储:" << count << "只股票";
+        return 0;
+    }
+
+    if (parser.isSet(exportTicksOption)) {
+        return DatabaseHelper::instance().exportTicks(parser.value(exportTicksOption)) ? 0 : 1;
+    }
+
+    if (parser.isSet(benchChartOption)) {
+        return ChartBenchmark::run(qMax(2, parser.value(benchChartOption).toInt()));
+    }
+
+    if (parser.isSet(benchChartUpdateOption)) {
+        return ChartBenchmark::runUpdate(qMax(2, parser.value(benchChartUpdateOption).toInt()));
+    }
+
+    if (parser.isSet(benchFormatOption)) {
+        return NumberFormatter::benchmark(qMax(1, parser.value(benchFormatOption).toInt()));
+    }
+
+    if (parser.isSet(benchTableOption)) {
+        return QuoteTableModel::benchmark(qMax(1, parser.value(benchTableOption).toInt()));
+    }
+
+    if (parser.isSet(benchThemeOption)) {
+        return ThemeManager::benchmark(qMax(1, parser.value(benchThemeOption).toInt()));
+    }
+
+    // 在创建任何控件之前设置样式和样式表，避免已有控件全部重新polish
+    ThemeManager::instance();
 
     MainWindow window;
     window.show();
+    StartupProfiler::mark("窗口显示");
 
     return app.exec();
 }
@@ -3,11 +3,24 @@
 #include "httphelper.h"
 #include "thememanager.h"
 #include "databasehelper.h"
+#include "retentionmanager.h"
+#include "startupprofiler.h"
+#include "renderscheduler.h"
+#include "candlechart.h"
+#include "chartgrid.h"
+#include "chartcrosshair.h"
+#include "sparklinedelegate.h"
+#include "quotetablemodel.h"
+#include "numberformatter.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QPushButton>
 #include <QLabel>
+#include <QComboBox>
+#include <QStackedWidget>
+#include <QLineEdit>
 #include <QHeaderView>
+#include <QScrollBar>
 #include <QApplication>
 #include <QMessageBox>
 #include <QDateTime>
@@ -22,10 +35,26 @@
 #include <QApplication>
 #include <QScreen>
 #include <QGuiApplication>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QRunnable>
+#include <QRegExp>
+#include <QSettings>
+#include <QtNumeric>
 
 // 包含QCustomPlot头文件
 #include "qcustomplot.h"
 
+namespace {
+
+// 未单独配置时每只股票保留的点数
+const int DefaultSeriesCapacity = 256;
+
+// 价格序列的默认内存上限（MB）
+const int DefaultSeriesLimitMb = 64;
+
+} // namespace
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_centralWidget(nullptr)
@@ -33,10 +62,19 @@ MainWindow::MainWindow(QWidget *parent)
     , m_mainLayout(nullptr)
     , m_controlLayout(nullptr)
     , m_titleLayout(nullptr)
-    , m_tableWidget(nullptr)
+    , m_tableView(nullptr)
+    , m_quoteModel(nullptr)
+    , m_sparklineDelegate(nullptr)
     , m_chartWidget(nullptr)
+    , m_candleChart(nullptr)
+    , m_crosshair(nullptr)
+    , m_chartStack(nullptr)
+    , m_chartGrid(nullptr)
     , m_historyButton(nullptr)
     , m_refreshButton(nullptr)
+    , m_chartModeBox(nullptr)
+    , m_gridButton(nullptr)
+    , m_filterEdit(nullptr)
     , m_statusLabel(nullptr)
     , m_titleLabel(nullptr)
     , m_minimizeButton(nullptr)
@@ -44,30 +82,158 @@ MainWindow::MainWindow(QWidget *parent)
     , m_closeButton(nullptr)
     , m_networkManager(new QNetworkAccessManager(this))
     , m_refreshTimer(new QTimer(this))
+    , m_retentionManager(new RetentionManager(this))
+    , m_renderScheduler(new RenderScheduler(this))
+    , m_firstPaintDone(false)
+    , m_firstDataReceived(false)
     , m_isDragging(false)
     , m_isMaximized(false)
     , m_isDarkTheme(false)
     , m_themeManager(&ThemeManager::instance())
+    , m_seriesStore(DefaultSeriesCapacity)
+    , m_fullChartUpdate(qEnvironmentVariableIsSet("TICKERLITE_FULL_CHART_UPDATE"))
+    , m_lodActive(false)
+    , m_lodDirty(false)
+    , m_updatingChart(false)
 {
     // 初始化股票代码列表
-    m_stockCodes << "sh600000" << "sh600036" << "sz000001" << "sz000002";
+    loadWatchlist();
+    m_chartCode = m_stockCodes.first();
+    m_seriesStore.setActive(m_chartCode);
 
     // 设置UI
     setupUI();
 
-    // 设置定时器
+    // 设置定时器，数据库和历史就绪后再启动
     connect(m_refreshTimer, &QTimer::timeout, this, &MainWindow::refreshData);
-    m_refreshTimer->start(2000); // 每2秒刷新一次
 
-    // 加载历史数据
-    historyData();
+    // 行情回包只标记脏区域，按帧合并刷新
+    QSettings settings(DatabaseHelper::dataDirectory() + "/tickerlite.ini", QSettings::IniFormat);
+    m_renderScheduler->setMaxFps(settings.value("render/max_fps", 30).toInt());
+    connect(m_renderScheduler, &RenderScheduler::frame, this, &MainWindow::onRenderFrame);
 
-    // 初始刷新数据
-    refreshData();
+    // 首次绘制后再依次初始化数据库、加载历史、发起网络请求
+    m_centralWidget->installEventFilter(this);
+
+    StartupProfiler::mark("主窗口构造");
 }
 
 MainWindow::~MainWindow()
 {
+    // 等待启动任务结束，之后投递给本窗口的回调会随窗口一起丢弃
+    m_startupPool.waitForDone();
+}
+
+void MainWindow::loadWatchlist()
+{
+    // 数据目录下的 watchlist.txt 每行一个代码，不存在时使用示例列表
+    // 代码后可跟该股票保留的点数，如 "sh600000 1024"，会向上取整到2的幂
+    QFile file(DatabaseHelper::dataDirectory() + "/watchlist.txt");
+    if (file.open(QFile::ReadOnly | QFile::Text)) {
+        QTextStream in(&file);
+        while (!in.atEnd()) {
+            QString line = in.readLine().trimmed();
+            if (line.isEmpty() || line.startsWith('#')) {
+                continue;
+            }
+
+            QStringList fields = line.split(QRegExp("\\s+"));
+            m_stockCodes << fields.first();
+            if (fields.size() > 1 && fields.at(1).toInt() > 0) {
+                m_seriesStore.setCapacity(fields.first(), fields.at(1).toInt());
+            }
+        }
+    }
+
+    if (m_stockCodes.isEmpty()) {
+        m_stockCodes << "sh600000" << "sh600036" << "sz000001" << "sz000002";
+    }
+
+    // 内存中价格序列的总上限，超出时淘汰最久未用的股票
+    QSettings settings(DatabaseHelper::dataDirectory() + "/tickerlite.ini", QSettings::IniFormat);
+    int limitMb = settings.value("memory/series_limit_mb", DefaultSeriesLimitMb).toInt();
+    m_seriesStore.setMemoryLimit(qint64(limitMb) * 1024 * 1024);
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_centralWidget && event->type() == QEvent::Paint && !m_firstPaintDone) {
+        m_firstPaintDone = true;
+        StartupProfiler::mark("首次绘制");
+        // 等本次绘制完成后再开始后续初始化
+        QTimer::singleShot(0, this, &MainWindow::startDeferredInit);
+    }
+    if (m_tableView && watched == m_tableView->viewport() && event->type() == QEvent::Resize) {
+        updateVisibleRows();
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::startDeferredInit()
+{
+    populateTable();
+    StartupProfiler::mark("表格填充");
+
+    m_statusLabel->setText("正在打开数据库...");
+
+    // 建表、建索引可能很慢（旧库首次升级），放到后台线程
+    m_startupPool.start(QRunnable::create([this]() {
+        bool success = DatabaseHelper::prepareSchema();
+        QMetaObject::invokeMethod(this, [this, success]() {
+            onSchemaReady(success);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void MainWindow::onSchemaReady(bool success)
+{
+    StartupProfiler::mark("数据库结构检查");
+
+    // 主线程的连接只需打开并预编译语句
+    if (!success || !DatabaseHelper::instance().initializeDatabase()) {
+        m_statusLabel->setText("数据库初始化失败");
+        startRefreshing();
+        return;
+    }
+    StartupProfiler::mark("数据库就绪");
+
+    // K线表为空时先在后台从已有tick生成，完成前不写入新tick，避免与重建交错
+    DatabaseHelper &db = DatabaseHelper::instance();
+    if (db.needsBarRebuild()) {
+        const QStringList codes = db.getAllStockCodes();
+        m_statusLabel->setText(QString("正在生成K线 0/%1").arg(codes.size()));
+        m_startupPool.start(QRunnable::create([this, codes]() {
+            DatabaseHelper::rebuildBarsForSymbols(codes, [this](int finished, int total) {
+                QMetaObject::invokeMethod(this, [this, finished, total]() {
+                    m_statusLabel->setText(QString("正在生成K线 %1/%2").arg(finished).arg(total));
+                }, Qt::QueuedConnection);
+            });
+            QMetaObject::invokeMethod(this, [this]() {
+                DatabaseHelper::instance().resetBarBaseline();
+                onDatabaseReady();
+            }, Qt::QueuedConnection);
+        }));
+        return;
+    }
+
+    onDatabaseReady();
+}
+
+void MainWindow::onDatabaseReady()
+{
+    // 启动后台数据保留清理，策略可在数据目录的 retention.ini 中按分组配置
+    QFileInfo dbInfo(DatabaseHelper::instance().databasePath());
+    m_retentionManager->loadPolicies(dbInfo.absolutePath() + "/retention.ini");
+    m_retentionManager->start();
+
+    warmUpHistory();
+}
+
+void MainWindow::startRefreshing()
+{
+    m_refreshTimer->start(2000); // 每2秒刷新一次
+    refreshData();
+    StartupProfiler::mark("发起行情请求");
 }
 
 void MainWindow::setupUI()
@@ -136,6 +302,28 @@ void MainWindow::setupUI()
     m_groupBtn->addButton(m_historyButton);
     m_groupBtn->addButton(m_refreshButton);
 
+    // 图表类型：分时或各周期K线，数据为K线周期秒数
+    m_chartModeBox = new QComboBox(this);
+    m_chartModeBox->addItem("分时", 0);
+    m_chartModeBox->addItem("1分钟K线", 60);
+    m_chartModeBox->addItem("5分钟K线", 5 * 60);
+    m_chartModeBox->addItem("15分钟K线", 15 * 60);
+    m_chartModeBox->addItem("1小时K线", 3600);
+    m_chartModeBox->addItem("日K线", 24 * 3600);
+    connect(m_chartModeBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onChartModeChanged);
+
+    // 多图：同时显示多只股票的分时小图
+    m_filterEdit = new QLineEdit(this);
+    m_filterEdit->setPlaceholderText("筛选：代码/名称，或 >3、<-2、1~5");
+    m_filterEdit->setClearButtonEnabled(true);
+    m_filterEdit->setMaximumWidth(200);
+    connect(m_filterEdit, &QLineEdit::textChanged, this, &MainWindow::onFilterChanged);
+
+    m_gridButton = new QPushButton("多图", this);
+    m_gridButton->setCheckable(true);
+    connect(m_gridButton, &QPushButton::toggled, this, &MainWindow::onGridToggled);
+
     // 创建状态标签
     m_statusLabel = new QLabel("准备就绪", this);
     m_statusLabel->setObjectName("statusLabel");
@@ -143,6 +331,9 @@ void MainWindow::setupUI()
     // 添加控件到控制布局
     m_controlLayout->addWidget(m_historyButton);
     m_controlLayout->addWidget(m_refreshButton);
+    m_controlLayout->addWidget(m_chartModeBox);
+    m_controlLayout->addWidget(m_gridButton);
+    m_controlLayout->addWidget(m_filterEdit);
     m_controlLayout->addWidget(m_statusLabel);
     m_controlLayout->addStretch();
 
@@ -155,9 +346,19 @@ void MainWindow::setupUI()
     // 初始化图表
     initializeChart();
 
+    // 单只股票的图表和多图墙叠放，同一时间只显示一个
+    m_chartGrid = new ChartGrid(&m_seriesStore, this);
+    connect(m_chartGrid, &ChartGrid::symbolActivated, this, [this](const QString &code) {
+        m_gridButton->setChecked(false);
+        showChart(code);
+    });
+    m_chartStack = new QStackedWidget(this);
+    m_chartStack->addWidget(m_chartWidget);
+    m_chartStack->addWidget(m_chartGrid);
+
     // 添加表格和图表到分割器
-    splitter->addWidget(m_tableWidget);
-    splitter->addWidget(m_chartWidget);
+    splitter->addWidget(m_tableView);
+    splitter->addWidget(m_chartStack);
 
     // 设置分割器比例
     splitter->setSizes({300, 200});
@@ -178,6 +379,11 @@ void MainWindow::setupUI()
     setAttribute(Qt::WA_TranslucentBackground);
     m_centralWidget->setObjectName("centralWidget");
 
+    // 圆角和边框由样式表按主题绘制，其余控件只用调色板
+    m_themeManager->addStyledWidget(m_centralWidget);
+    m_themeManager->addStyledWidget(m_titleBar);
+    m_themeManager->addStyledWidget(m_statusLabel);
+
     // 应用初始主题
     applyTheme(m_isDarkTheme);
 
@@ -185,35 +391,42 @@ void MainWindow::setupUI()
 
 void MainWindow::initializeTable()
 {
-    // 创建表格
-    m_tableWidget = new QTableWidget(this);
-
-    // 设置列
-    QStringList headers;
-    headers << "股票代码" << "名称" << "当前价" << "涨跌额" << "涨跌幅(%)" 
-            << "昨收价" << "开盘价" << "成交量" << "外盘" << "内盘" << "更新时间";
-    m_tableWidget->setColumnCount(headers.size());
-    m_tableWidget->setHorizontalHeaderLabels(headers);
-
-    // 设置行数
-    m_tableWidget->setRowCount(m_stockCodes.size());
+    // 创建表格，列和表头由模型提供
+    m_quoteModel = new QuoteTableModel(this);
+    m_tableView = new QTableView(this);
+    m_tableView->setModel(m_quoteModel);
 
     // 设置表格属性
-    m_tableWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
-    m_tableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
-    m_tableWidget->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-    m_tableWidget->setAlternatingRowColors(true); // 启用交替行颜色
-    m_tableWidget->verticalHeader()->setVisible(false); // 隐藏垂直表头
-
-    // 初始化表格内容
-    for (int i = 0; i < m_stockCodes.size(); ++i) {
-        // 显示股票代码时去除前缀"v_"
-        QString displayCode = m_stockCodes[i].mid(2); // 去掉"v_"前缀
-        m_tableWidget->setItem(i, 0, new QTableWidgetItem(displayCode));
-        for (int j = 1; j < headers.size(); ++j) {
-            m_tableWidget->setItem(i, j, new QTableWidgetItem("--"));
-        }
-    }
+    m_tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    m_tableView->setAlternatingRowColors(true); // 启用交替行颜色
+    m_tableView->verticalHeader()->setVisible(false); // 隐藏垂直表头
+    // 固定行高，上万行时不需要逐行计算高度
+    m_tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    // 点击表头排序，初始按自选股列表的顺序
+    m_tableView->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+    m_tableView->setSortingEnabled(true);
+
+    // 走势列由委托从内存序列绘制，缓存为图片
+    m_sparklineDelegate = new SparklineDelegate(&m_seriesStore, this);
+    m_tableView->setItemDelegateForColumn(QuoteTableModel::TrendColumn, m_sparklineDelegate);
+
+    // 点击任意行切换图表
+    connect(m_tableView, &QTableView::clicked, this, &MainWindow::onTableClicked);
+
+    // 跟踪视口内的行，滚动、改变大小和重设股票列表后更新
+    connect(m_tableView->verticalScrollBar(), &QScrollBar::valueChanged, this, &MainWindow::updateVisibleRows);
+    connect(m_quoteModel, &QAbstractItemModel::modelReset, this, &MainWindow::updateVisibleRows);
+    connect(m_quoteModel, &QAbstractItemModel::rowsInserted, this, &MainWindow::updateVisibleRows);
+    connect(m_quoteModel, &QAbstractItemModel::rowsRemoved, this, &MainWindow::updateVisibleRows);
+    m_tableView->viewport()->installEventFilter(this);
+}
+
+void MainWindow::populateTable()
+{
+    // 只分配各列的数组，单元格文字在显示时才生成
+    m_quoteModel->setStockCodes(m_stockCodes);
 }
 
 void MainWindow::initializeChart()
@@ -221,15 +434,40 @@ void MainWindow::initializeChart()
     // 创建图表
     m_chartWidget = new QCustomPlot(this);
 
+    // 可选用OpenGL绘制，编译时未启用或无法创建上下文时仍为软件绘制
+    QSettings settings(DatabaseHelper::dataDirectory() + "/tickerlite.ini", QSettings::IniFormat);
+    if (settings.value("render/opengl", false).toBool()) {
+        m_chartWidget->setOpenGl(true);
+        qDebug() << "图表绘制方式:" << (m_chartWidget->openGl() ? "OpenGL" : "软件（OpenGL不可用）");
+    }
+
+    // 分层缓存：网格、坐标轴、图例所在的层只在缩放、改变大小和切换主题时重绘；
+    // 曲线在网格之上、坐标轴和图例之下的单独缓冲层，十字光标在最上面的overlay层，行情更新时只重绘这两层
+    m_chartWidget->addLayer("series", m_chartWidget->layer("main"), QCustomPlot::limAbove);
+    m_chartWidget->layer("series")->setMode(QCPLayer::lmBuffered);
+    m_chartWidget->layer("overlay")->setMode(QCPLayer::lmBuffered);
+
     // 配置图表
     m_chartWidget->addGraph();
+    m_chartWidget->graph(0)->setLayer("series");
     m_chartWidget->graph(0)->setPen(QPen(Qt::blue));
     m_chartWidget->graph(0)->setName("价格走势");
 
+    // K线图与分时图共用坐标轴，切换时只切换可见的曲线
+    m_candleChart = new CandleChart(m_chartWidget, this);
+
+    // 十字光标在overlay层上，同时用于分时图和K线图
+    m_crosshair = new ChartCrosshair(m_chartWidget, this);
+
     // 设置坐标轴标签
     m_chartWidget->xAxis->setLabel("时间");
     m_chartWidget->yAxis->setLabel("价格");
 
+    // 格式化X轴为时间，刻度器只创建一次
+    QSharedPointer<QCPAxisTickerDateTime> dateTicker(new QCPAxisTickerDateTime);
+    dateTicker->setDateTimeFormat("hh:mm:ss");
+    m_chartWidget->xAxis->setTicker(dateTicker);
+
     // 设置坐标轴范围
     m_chartWidget->xAxis->setRange(0, 10);
     m_chartWidget->yAxis->setRange(0, 20);
@@ -243,12 +481,14 @@ void MainWindow::initializeChart()
 
     // 设置交互
     m_chartWidget->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+    connect(m_chartWidget->xAxis, QOverload<const QCPRange &>::of(&QCPAxis::rangeChanged),
+            this, &MainWindow::onChartRangeChanged);
 }
 
 void MainWindow::historyData()
 {
-    // 默认查询sh600000股票过去5分钟的历史数据
-    QString stockCode = "sh600000";
+    // 查询图表当前股票过去5分钟的历史数据
+    QString stockCode = m_chartCode;
     
     // 确保数据库已初始化
     if (!DatabaseHelper::instance().initializeDatabase()) {
@@ -277,10 +517,7 @@ void MainWindow::historyData()
         // 获取价格
         double price = record["price"].toDouble();
         
-        if (!m_datas.HasTimestamp(timestampSec))
-        {
-            m_datas.Update(timestampSec, price);
-        }
+        m_seriesStore.append(stockCode, timestampSec, price);
     }
     
     // 更新图表
@@ -290,16 +527,84 @@ void MainWindow::historyData()
     m_statusLabel->setText(QString("已加载 %1 的历史数据").arg(stockCode));
 }
 
+void MainWindow::warmUpHistory()
+{
+    // 数据库已在主线程初始化，加载在后台线程中进行，不阻塞界面
+    const QStringList codes = m_stockCodes;
+    int maxPoints = 0;
+    for (const QString &code : codes) {
+        maxPoints = qMax(maxPoints, m_seriesStore.ensure(code)->capacity());
+    }
+
+    m_startupPool.start(QRunnable::create([this, codes, maxPoints]() {
+        HistoryLoader loader;
+        loader.setWindow(30 * 60 * 1000);   // 最近30分钟
+        loader.setMaxPoints(maxPoints);     // 与序列保留的点数一致
+        loader.setTimeBudget(1000);
+        connect(&loader, &HistoryLoader::progress, this, [this](int finished, int total) {
+            m_statusLabel->setText(QString("正在加载历史数据 %1/%2").arg(finished).arg(total));
+        }, Qt::QueuedConnection);
+
+        QHash<QString, TickSeries> history = loader.load(codes);
+        bool complete = loader.isComplete();
+        QMetaObject::invokeMethod(this, [this, history, complete]() {
+            applyHistory(history, complete);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void MainWindow::applyHistory(const QHash<QString, TickSeries> &history, bool complete)
+{
+    // 只写入受内存上限约束的序列存储，不另外保留一份
+    for (auto it = history.constBegin(); it != history.constEnd(); ++it) {
+        TimeSeriesStore::Series *series = m_seriesStore.ensure(it.key());
+        for (int i = 0; i < it->size(); ++i) {
+            series->append(it->keys.at(i), it->values.at(i));
+        }
+    }
+
+    updateChart();
+
+    m_sparklineDelegate->invalidateAll();
+    m_tableView->viewport()->update();
+
+    m_statusLabel->setText(QString("已预加载 %1 只股票的历史数据%2")
+                           .arg(history.size())
+                           .arg(complete ? "" : "（部分）"));
+    StartupProfiler::mark("历史加载");
+
+    // 历史在前、实时在后，图表数据保持时间顺序
+    startRefreshing();
+}
+
 void MainWindow::refreshData()
 {
     m_statusLabel->setText("正在刷新数据...");
+
+    // 视口内的股票先请求并提高优先级，其余的排在后面
+    QStringList codes;
+    codes.reserve(m_stockCodes.size());
+    for (int row = 0; row < m_stockCodes.size(); ++row) {
+        if (m_quoteModel->isRowVisible(row)) {
+            codes << m_stockCodes.at(row);
+        }
+    }
+    const int visibleCount = codes.size();
+    for (int row = 0; row < m_stockCodes.size(); ++row) {
+        if (!m_quoteModel->isRowVisible(row)) {
+            codes << m_stockCodes.at(row);
+        }
+    }
+
     // 遍历所有股票代码，请求数据
-    for (const QString &code : m_stockCodes) {
-        
+    for (int i = 0; i < codes.size(); ++i) {
+        const QString &code = codes.at(i);
+
         // 构建腾讯行情接口URL    
         QString url = QString("http://qt.gtimg.cn/q=%1").arg(code);        
         QNetworkRequest request;    
         request.setUrl(QUrl(url));    
+        request.setPriority(i < visibleCount ? QNetworkRequest::HighPriority : QNetworkRequest::LowPriority);
         request.setRawHeader("User-Agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36");
         // 腾讯接口始终返回GBK编码，需要在客户端进行转换
         QNetworkReply *reply = m_networkManager->get(request);
@@ -358,48 +663,32 @@ void MainWindow::onNetworkReplyFinished(QNetworkReply *reply)
                 volume, outerDisc, innerDisc, timestamp.toLongLong()
             );
 
+            if (!m_firstDataReceived) {
+                m_firstDataReceived = true;
+                StartupProfiler::mark("首批行情");
+                StartupProfiler::report();
+            }
+
+            // 时间不晚于序列末尾的点会被忽略
+            if (m_seriesStore.append(code, timestamp.toLongLong() / 1000.0, price.toDouble())) {
+                m_sparklineDelegate->invalidate(code);
+            }
+
             // 找到对应的行
-            int row = m_stockCodes.indexOf(code);
+            int row = m_quoteModel->rowOf(code);
             if (row >= 0) {
-                // 更新表格
-                m_tableWidget->setItem(row, 1, new QTableWidgetItem(name));
-                m_tableWidget->setItem(row, 2, new QTableWidgetItem(price));
-                m_tableWidget->setItem(row, 3, new QTableWidgetItem(change));
-                m_tableWidget->setItem(row, 4, new QTableWidgetItem(changePercent));
-                m_tableWidget->setItem(row, 5, new QTableWidgetItem(prevClose));
-                m_tableWidget->setItem(row, 6, new QTableWidgetItem(openPrice));
-                m_tableWidget->setItem(row, 7, new QTableWidgetItem(volume));
-                m_tableWidget->setItem(row, 8, new QTableWidgetItem(outerDisc));
-                m_tableWidget->setItem(row, 9, new QTableWidgetItem(innerDisc));
-                m_tableWidget->setItem(row, 10, new QTableWidgetItem(QDateTime::fromMSecsSinceEpoch(timestamp.toLongLong()).toString("hh:mm:ss")));
-
-                // 根据涨跌设置颜色
-                double changeValue = change.toDouble();
-                QColor color;
-                if (m_isDarkTheme) {
-                    // 深色主题：涨为浅红色，跌为浅绿色
-                    color = (changeValue >= 0) ? QColor(255, 100, 100) : QColor(100, 255, 100);
-                } else {
-                    // 浅色主题：涨为红色，跌为绿色
-                    color = (changeValue >= 0) ? Qt::red : Qt::green;
+                // 只写入模型，表格和图表在下一帧统一刷新
+                if (m_quoteModel->setQuote(row, parts)) {
+                    m_renderScheduler->markRowDirty(row);
+                }
+                if (m_chartGrid->isVisible() && m_chartGrid->contains(code)) {
+                    m_chartGrid->markDirty(code);
+                    m_renderScheduler->markChartDirty();
                 }
-                m_tableWidget->item(row, 2)->setForeground(color);
-                m_tableWidget->item(row, 3)->setForeground(color);
-                m_tableWidget->item(row, 4)->setForeground(color);
-
-                // 更新图表（以第一个股票为例）
-                if (row == 0) {
-                    // 添加新数据点
-                    double currentTime = timestamp.toLongLong() / 1000.0;
-                    double currentPrice = price.toDouble();
-
-                    if (!m_datas.HasTimestamp(currentTime))
-                    {
-                        m_datas.Update(currentTime, currentPrice);
-                    }
-
-                    // 更新图表
-                    updateChart();
+                if (code == m_chartCode) {
+                    // K线只在内存中原地更新，重绘同样等到下一帧
+                    m_candleChart->addTick(timestamp.toLongLong(), price.toDouble(), volume.toLongLong());
+                    m_renderScheduler->markChartDirty();
                 }
             }
         }
@@ -437,118 +726,134 @@ QString MainWindow::loadStyleSheet(const QString &fileName)
 
 void MainWindow::applyTheme(bool isDark)
 {
-    // 使用主题管理器设置主题
+    // 调色板和图表配色已由主题管理器预先生成，这里只套用，重绘都留给下一次事件循环
     m_themeManager->setTheme(isDark ? ThemeManager::Dark : ThemeManager::Light);
-    
-    // 设置标题栏样式
-    if (isDark) {
-        // 更新图表样式
-        m_chartWidget->setBackground(QBrush(QColor(43, 43, 43)));
-        m_chartWidget->xAxis->setTickLabelColor(Qt::white);
-        m_chartWidget->yAxis->setTickLabelColor(Qt::white);
-        m_chartWidget->xAxis->setLabelColor(Qt::white);
-        m_chartWidget->yAxis->setLabelColor(Qt::white);
-        m_chartWidget->xAxis->setBasePen(QPen(Qt::white));
-        m_chartWidget->yAxis->setBasePen(QPen(Qt::white));
-        m_chartWidget->xAxis->setTickPen(QPen(Qt::white));
-        m_chartWidget->yAxis->setTickPen(QPen(Qt::white));
-        m_chartWidget->xAxis->setSubTickPen(QPen(Qt::white));
-        m_chartWidget->yAxis->setSubTickPen(QPen(Qt::white));
-        m_chartWidget->xAxis->grid()->setPen(QPen(QColor(80, 80, 80), 0, Qt::DotLine));
-        m_chartWidget->yAxis->grid()->setPen(QPen(QColor(80, 80, 80), 0, Qt::DotLine));
-        m_chartWidget->graph(0)->setPen(QPen(Qt::red));
-    } else {
-        // 更新图表样式
-        m_chartWidget->setBackground(QBrush(QColor(255, 255, 255)));
-        m_chartWidget->xAxis->setTickLabelColor(Qt::black);
-        m_chartWidget->yAxis->setTickLabelColor(Qt::black);
-        m_chartWidget->xAxis->setLabelColor(Qt::black);
-        m_chartWidget->yAxis->setLabelColor(Qt::black);
-        m_chartWidget->xAxis->setBasePen(QPen(Qt::black));
-        m_chartWidget->yAxis->setBasePen(QPen(Qt::black));
-        m_chartWidget->xAxis->setTickPen(QPen(Qt::black));
-        m_chartWidget->yAxis->setTickPen(QPen(Qt::black));
-        m_chartWidget->xAxis->setSubTickPen(QPen(Qt::black));
-        m_chartWidget->yAxis->setSubTickPen(QPen(Qt::black));
-        m_chartWidget->xAxis->grid()->setPen(QPen(QColor(200, 200, 200), 0, Qt::DotLine));
-        m_chartWidget->yAxis->grid()->setPen(QPen(QColor(200, 200, 200), 0, Qt::DotLine));
-        m_chartWidget->graph(0)->setPen(QPen(Qt::blue));
-    }
-    
-    // 更新表格项颜色
-    for (int row = 0; row < m_tableWidget->rowCount(); ++row) {
-        QTableWidgetItem *changeItem = m_tableWidget->item(row, 3); // 涨跌额
-        if (changeItem) {
-            double changeValue = changeItem->text().toDouble();
-            QColor color;
-            if (isDark) {
-                // 深色主题：涨为浅红色，跌为浅绿色
-                color = (changeValue >= 0) ? QColor(255, 100, 100) : QColor(100, 255, 100);
-            } else {
-                // 浅色主题：涨为红色，跌为绿色
-                color = (changeValue >= 0) ? Qt::red : Qt::green;
-            }
-            m_tableWidget->item(row, 2)->setForeground(color); // 当前价
-            m_tableWidget->item(row, 3)->setForeground(color); // 涨跌额
-            m_tableWidget->item(row, 4)->setForeground(color); // 涨跌幅
-        }
-    }
-    
-    // 更新主题切换按钮图标和样式
+    m_themeManager->applyChartTheme(m_chartWidget);
+    m_chartWidget->replot(QCustomPlot::rpQueuedReplot);
+    m_chartGrid->setDarkTheme(isDark);
+    m_crosshair->setDarkTheme(isDark);
+
+    // 更新表格涨跌颜色，只重绘可见单元格
+    m_quoteModel->setDarkTheme(isDark);
+
+    // 更新主题切换按钮文字
     QPushButton *themeButton = m_titleBar->findChild<QPushButton*>("themeButton");
     if (themeButton) {
         themeButton->setText(isDark ? "Dark" : "Light");
-        m_themeManager->updateWidgetStyle(themeButton);
     }
-    
-    // 更新状态标签样式
-    m_themeManager->updateWidgetStyle(m_statusLabel);
-    
-    // 更新历史数据按钮样式
-    m_themeManager->updateWidgetStyle(m_historyButton);
-    
-    // 更新主窗口样式
-    m_themeManager->updateWidgetStyle(this);
-    
-    // 更新图表样式
-    m_themeManager->updateWidgetStyle(m_chartWidget);
 }
 
 void MainWindow::updateChart()
 {
-    QReadLocker rlock(&m_datas.lock);
-    if (m_datas.timestamps.isEmpty() || m_datas.prices.isEmpty()) {
+    // K线模式下由K线图自行更新
+    if (m_candleChart->isActive()) {
         return;
     }
 
-    // 更新图表数据
-    m_chartWidget->graph(0)->setData(m_datas.timestamps, m_datas.prices);
+    QCPGraph *graph = m_chartWidget->graph(0);
+    TimeSeriesStore::Series *series = m_seriesStore.series(m_chartCode);
+    if (!series) {
+        // 切换到没有数据的股票时清空旧曲线
+        if (m_plottedCode != m_chartCode) {
+            graph->data()->clear();
+            m_chartPyramid.clear();
+            m_plottedCode = m_chartCode;
+            m_chartWidget->replot();
+        }
+        return;
+    }
+
+    QVector<double> timestamps;
+    QVector<double> prices;
+    const bool rebuild = m_fullChartUpdate || m_plottedCode != m_chartCode || m_chartPyramid.isEmpty();
+    if (rebuild) {
+        // 切换股票或首次绘制时整体设置，快照已按时间排序
+        series->snapshot(timestamps, prices);
+        m_chartPyramid.clear();
+        m_plottedCode = m_chartCode;
+        m_priceExtremes.setWindow(series->capacity());
+        m_priceExtremes.clear();
+    } else {
+        // 只取已绘制的最后一个点之后的新点
+        series->snapshotAfter(m_chartPyramid.lastKey(), timestamps, prices);
+        if (timestamps.isEmpty() && !m_lodDirty) {
+            return;
+        }
+    }
+    for (int i = 0; i < timestamps.size(); ++i) {
+        m_chartPyramid.append(timestamps.at(i), prices.at(i));
+        m_priceExtremes.append(prices.at(i));
+    }
+
+    // 金字塔与序列保留相同数量的点，多出容量的1/8再一起丢弃，摊薄移动数组的开销
+    const int capacity = series->capacity();
+    if (m_chartPyramid.size() - capacity > capacity / 8) {
+        m_chartPyramid.removeFirst(m_chartPyramid.size() - capacity);
+    }
+
+    if (m_chartPyramid.isEmpty()) {
+        graph->data()->clear();
+        m_chartWidget->replot();
+        return;
+    }
+
+    // 新点仍在当前坐标范围内时只重绘曲线所在的层
+    const double minTime = m_chartPyramid.key(qMax(0, m_chartPyramid.size() - capacity));
+    const double maxTime = m_chartPyramid.lastKey();
+    const double minPrice = m_priceExtremes.minimum();
+    const double maxPrice = m_priceExtremes.maximum();
+    const QCPRange xRange = m_chartWidget->xAxis->range();
+    const QCPRange yRange = m_chartWidget->yAxis->range();
+    const bool rangeChanged = rebuild || maxTime > xRange.upper
+                              || minPrice < yRange.lower || maxPrice > yRange.upper;
 
     // 调整坐标轴范围
-    if (m_datas.timestamps.size() > 1) {
-        double minTime = m_datas.timestamps.first();
-        double maxTime = m_datas.timestamps.last();
+    if (rangeChanged && m_chartPyramid.size() > 1) {
+        m_updatingChart = true;
         double timeRange = maxTime - minTime;
 
-        // 扩展范围以留出边距
-        m_chartWidget->xAxis->setRange(minTime - timeRange * 0.1, maxTime + timeRange * 0.1);
+        // 扩展范围以留出边距，右侧多留一些，新点在较长时间内都不需要重绘背景
+        m_chartWidget->xAxis->setRange(minTime - timeRange * 0.1, maxTime + timeRange * 0.25);
 
-        // 计算价格范围
-        double minPrice = *std::min_element(m_datas.prices.begin(), m_datas.prices.end());
-        double maxPrice = *std::max_element(m_datas.prices.begin(), m_datas.prices.end());
         double priceRange = maxPrice - minPrice;
 
         // 扩展范围以留出边距
         m_chartWidget->yAxis->setRange(minPrice - priceRange * 0.1, maxPrice + priceRange * 0.1);
+        m_updatingChart = false;
     }
 
-    // 格式化X轴为时间
-    QSharedPointer<QCPAxisTickerDateTime> dateTicker(new QCPAxisTickerDateTime);
-    dateTicker->setDateTimeFormat("hh:mm:ss");
-    m_chartWidget->xAxis->setTicker(dateTicker);
+    // 点数超过绘图区宽度的2倍时按可见范围抽稀，每像素约2个点
+    const int width = qMax(1, m_chartWidget->axisRect()->width());
+    const bool lod = m_chartPyramid.size() > 2 * width;
+    if (lod) {
+        const QCPRange visible = m_chartWidget->xAxis->range();
+        QVector<double> keys;
+        QVector<double> values;
+        m_chartPyramid.query(qMax(visible.lower, minTime), visible.upper, width, keys, values);
+        graph->setData(keys, values, true);
+    } else if (rebuild || m_lodActive) {
+        if (!rebuild) {
+            series->snapshot(timestamps, prices);
+        }
+        graph->setData(timestamps, prices, true);
+    } else {
+        graph->addData(timestamps, prices, true);
 
-    // 重绘图表
-    m_chartWidget->replot();
+        // 与序列保留相同数量的点
+        int excess = graph->dataCount() - capacity;
+        if (excess > 0) {
+            graph->data()->removeBefore((graph->data()->constBegin() + excess)->key);
+        }
+    }
+    m_lodActive = lod;
+    m_lodDirty = false;
+
+    // 坐标范围变化时排队全部重绘，否则只重绘前景
+    if (rangeChanged) {
+        m_chartWidget->replot(QCustomPlot::rpQueuedReplot);
+    } else {
+        m_chartWidget->layer("series")->replot();
+    }
 }
 
 void MainWindow::onMinimizeButtonClicked()
@@ -622,36 +927,144 @@ void MainWindow::toggleTheme()
     applyTheme(m_isDarkTheme);
 }
 
-MainWindow::PrivateDatas::PrivateDatas()
+void MainWindow::onRenderFrame(bool chartDirty, const QList<int> &rows)
 {
-    timestamps.reserve(maxSize);
-    prices.reserve(maxSize);
+    // 先按新行情调整排序位置，再重绘有变化的单元格
+    m_quoteModel->applyPendingMoves();
+    for (int row : rows) {
+        m_quoteModel->commitRow(row);
+    }
+    if (chartDirty) {
+        m_chartGrid->refresh();
+        if (m_candleChart->isActive()) {
+            m_candleChart->refresh();
+        } else {
+            updateChart();
+        }
+    }
+}
+
+void MainWindow::onChartRangeChanged()
+{
+    // 缩放或拖动后按新的可见范围重新抽稀
+    if (!m_updatingChart && m_lodActive && !m_candleChart->isActive()) {
+        m_lodDirty = true;
+        m_renderScheduler->markChartDirty();
+    }
+}
+
+void MainWindow::onGridToggled(bool checked)
+{
+    if (checked) {
+        m_chartGrid->setSymbols(m_stockCodes);
+        m_chartStack->setCurrentWidget(m_chartGrid);
+    } else {
+        m_chartStack->setCurrentWidget(m_chartWidget);
+    }
+}
+
+void MainWindow::onChartModeChanged(int index)
+{
+    const int intervalSecs = m_chartModeBox->itemData(index).toInt();
+    QCPGraph *graph = m_chartWidget->graph(0);
+
+    if (intervalSecs > 0) {
+        graph->setVisible(false);
+        graph->removeFromLegend();
+        m_candleChart->setSymbol(m_chartCode);
+        m_candleChart->setInterval(intervalSecs);
+        m_candleChart->setActive(true);
+        return;
+    }
+
+    // 回到分时图，恢复时间格式并重新设置曲线数据
+    m_candleChart->setActive(false);
+    graph->setVisible(true);
+    graph->addToLegend();
+    QSharedPointer<QCPAxisTickerDateTime> ticker = m_chartWidget->xAxis->ticker().dynamicCast<QCPAxisTickerDateTime>();
+    if (ticker) {
+        ticker->setDateTimeFormat("hh:mm:ss");
+    }
+    m_plottedCode.clear();
+    updateChart();
 }
 
-void MainWindow::PrivateDatas::Update(double timestamp, double price)
+void MainWindow::onFilterChanged(const QString &text)
 {
-    QWriteLocker wLock(&lock);
-    if (timestamps.isEmpty() || timestamp > timestamps.last())
-    {
-        timestamps.push_back(timestamp);
-        prices.push_back(price);
-        if (timestamps.size() > maxSize)
-        {
-            timestamps.removeFirst();
-            prices.removeFirst();
+    // ">3"、"<-2"、"1~5"按排序列（未排序或按文字列排序时为涨跌幅）筛选数值，其余按代码或名称筛选
+    const QString filter = text.trimmed();
+    QRegExp rangeExp("^(-?\\d+(?:\\.\\d+)?)\\s*~\\s*(-?\\d+(?:\\.\\d+)?)$");
+    QRegExp boundExp("^([<>])\\s*(-?\\d+(?:\\.\\d+)?)$");
+
+    int column = m_quoteModel->sortColumn();
+    if (column < QuoteTableModel::PriceColumn) {
+        column = QuoteTableModel::ChangePercentColumn;
+    }
+
+    if (rangeExp.exactMatch(filter)) {
+        m_quoteModel->setTextFilter(QString());
+        m_quoteModel->setRangeFilter(column, rangeExp.cap(1).toDouble(), rangeExp.cap(2).toDouble());
+    } else if (boundExp.exactMatch(filter)) {
+        const double bound = boundExp.cap(2).toDouble();
+        m_quoteModel->setTextFilter(QString());
+        if (boundExp.cap(1) == ">") {
+            m_quoteModel->setRangeFilter(column, bound, qInf());
+        } else {
+            m_quoteModel->setRangeFilter(column, -qInf(), bound);
         }
+    } else {
+        m_quoteModel->setRangeFilter(-1, 0, 0);
+        m_quoteModel->setTextFilter(filter);
     }
+}
 
+void MainWindow::updateVisibleRows()
+{
+    const int rows = m_quoteModel->rowCount();
+    int first = m_tableView->rowAt(0);
+    int last = m_tableView->rowAt(m_tableView->viewport()->height() - 1);
+    if (first < 0) {
+        first = 0;
+    }
+    if (last < 0) {
+        last = rows - 1; // 最后一行下方还有空白
+    }
+    m_quoteModel->setVisibleRows(first, last);
 }
-bool MainWindow::PrivateDatas::HasTimestamp(double timestamp)
+
+void MainWindow::onTableClicked(const QModelIndex &index)
 {
-    QReadLocker rLock(&lock);
-    auto item = std::find_if(timestamps.cbegin(), timestamps.cend(), [timestamp](const double &a){
-        return (a == timestamp);
-    });
-    if (item != timestamps.cend())
-    {
-        return true;
+    if (index.isValid()) {
+        showChart(index.data(QuoteTableModel::StockCodeRole).toString());
+    }
+}
+
+void MainWindow::showChart(const QString &code)
+{
+    m_chartCode = code;
+    m_seriesStore.setActive(code);
+    m_chartWidget->graph(0)->setName(code);
+    m_candleChart->setSymbol(code);
+
+    // 已被淘汰或尚未收到数据时从数据库补齐
+    if (!m_seriesStore.contains(code) && DatabaseHelper::instance().initializeDatabase()) {
+        QDateTime endTime = QDateTime::currentDateTime();
+        QList<QVariantMap> records = DatabaseHelper::instance().getStockHistory(code, endTime.addSecs(-30 * 60), endTime);
+        for (const auto &record : records) {
+            m_seriesStore.append(code, record["timestamp"].toLongLong() / 1000.0, record["price"].toDouble());
+        }
+    }
+
+    updateChart();
+
+    TimeSeriesStore::Series *series = m_seriesStore.series(code);
+    QString status = QString("%1：%2 个点，占用 %3 KB，全部序列 %4 KB")
+                     .arg(code)
+                     .arg(series ? series->size() : 0)
+                     .arg(NumberFormatter::fixed(m_seriesStore.memoryUsage(code) / 1024.0, 1))
+                     .arg(NumberFormatter::fixed(m_seriesStore.memoryUsage() / 1024.0, 1));
+    if (m_seriesStore.evictedCount() > 0) {
+        status += QString("，超出上限累计淘汰 %1 只").arg(m_seriesStore.evictedCount());
     }
-    return false;
+    m_statusLabel->setText(status);
 }
@@ -0,0 +1,191 @@
+#include "minmaxpyramid.h"
+#include <algorithm>
+
+void MinMaxPyramid::clear()
+{
+    m_keys.clear();
+    m_values.clear();
+    m_levels.clear();
+    m_first = 0;
+}
+
+void MinMaxPyramid::append(double key, double value)
+{
+    const qint64 index = m_first + m_keys.size();
+    m_keys.append(key);
+    m_values.append(value);
+
+    const Bucket point = { key, value, key, value };
+    for (int level = 1; level <= m_levels.size(); ++level) {
+        addToLevel(level, index >> (FanoutBits * level), point);
+    }
+
+    // 最上层超过一个桶的宽度时再加一层
+    const int topSize = m_levels.isEmpty() ? m_keys.size() : m_levels.last().size();
+    if (topSize > Fanout) {
+        addLevel();
+    }
+}
+
+void MinMaxPyramid::removeFirst(int count)
+{
+    count = qMin(count, m_keys.size());
+    if (count <= 0) {
+        return;
+    }
+    if (count == m_keys.size()) {
+        clear();
+        return;
+    }
+
+    const qint64 oldFirst = m_first;
+    m_keys.remove(0, count);
+    m_values.remove(0, count);
+    m_first += count;
+
+    // 自下而上丢弃整桶，并重算只剩一部分点的第一个桶
+    for (int level = 1; level <= m_levels.size(); ++level) {
+        QVector<Bucket> &buckets = m_levels[level - 1];
+        const qint64 base = levelBase(level);
+        const int dropped = int(base - (oldFirst >> (FanoutBits * level)));
+        buckets.remove(0, qMin(dropped, buckets.size()));
+        if (!buckets.isEmpty()) {
+            buckets[0] = rebuildBucket(level, base);
+        }
+    }
+}
+
+int MinMaxPyramid::query(double lower, double upper, int maxBuckets,
+                         QVector<double> &keys, QVector<double> &values) const
+{
+    keys.clear();
+    values.clear();
+    if (m_keys.isEmpty() || upper < lower) {
+        return 0;
+    }
+    maxBuckets = qMax(1, maxBuckets);
+
+    int begin = int(std::lower_bound(m_keys.begin(), m_keys.end(), lower) - m_keys.begin());
+    int end = int(std::upper_bound(m_keys.begin(), m_keys.end(), upper) - m_keys.begin());
+    if (begin > 0) {
+        --begin;
+    }
+    if (end < m_keys.size()) {
+        ++end;
+    }
+
+    // 点数不多时直接用原始点
+    const qint64 count = end - begin;
+    if (count <= 2 * qint64(maxBuckets) || m_levels.isEmpty()) {
+        keys = m_keys.mid(begin, end - begin);
+        values = m_values.mid(begin, end - begin);
+        return 0;
+    }
+
+    // 选桶数不超过上限的最细一层
+    int level = 1;
+    while (level < m_levels.size() && (count >> (FanoutBits * level)) > maxBuckets) {
+        ++level;
+    }
+
+    const QVector<Bucket> &buckets = m_levels.at(level - 1);
+    const qint64 base = levelBase(level);
+    const int first = int(((m_first + begin) >> (FanoutBits * level)) - base);
+    const int last = int(((m_first + end - 1) >> (FanoutBits * level)) - base);
+
+    keys.reserve(2 * (last - first + 1));
+    values.reserve(2 * (last - first + 1));
+    for (int i = first; i <= last; ++i) {
+        const Bucket &bucket = buckets.at(i);
+        // 两个点按出现时间先后输出，曲线才能画出桶内的上下振幅
+        if (bucket.minKey < bucket.maxKey) {
+            keys << bucket.minKey << bucket.maxKey;
+            values << bucket.minValue << bucket.maxValue;
+        } else if (bucket.minKey > bucket.maxKey) {
+            keys << bucket.maxKey << bucket.minKey;
+            values << bucket.maxValue << bucket.minValue;
+        } else {
+            keys << bucket.minKey;
+            values << bucket.minValue;
+        }
+    }
+    return level;
+}
+
+void MinMaxPyramid::addToLevel(int level, qint64 bucketIndex, const Bucket &bucket)
+{
+    QVector<Bucket> &buckets = m_levels[level - 1];
+    if (bucketIndex - levelBase(level) == buckets.size()) {
+        buckets.append(bucket);
+    } else {
+        merge(buckets.last(), bucket);
+    }
+}
+
+void MinMaxPyramid::addLevel()
+{
+    const int level = m_levels.size() + 1;
+    m_levels.append(QVector<Bucket>());
+
+    // 由下一层汇总得到
+    if (level == 1) {
+        for (int i = 0; i < m_keys.size(); ++i) {
+            const Bucket point = { m_keys.at(i), m_values.at(i), m_keys.at(i), m_values.at(i) };
+            addToLevel(level, (m_first + i) >> FanoutBits, point);
+        }
+    } else {
+        const QVector<Bucket> &lower = m_levels.at(level - 2);
+        const qint64 lowerBase = levelBase(level - 1);
+        for (int i = 0; i < lower.size(); ++i) {
+            addToLevel(level, (lowerBase + i) >> FanoutBits, lower.at(i));
+        }
+    }
+}
+
+MinMaxPyramid::Bucket MinMaxPyramid::rebuildBucket(int level, qint64 bucketIndex) const
+{
+    const qint64 from = bucketIndex << FanoutBits;
+    const qint64 to = from + Fanout;
+    Bucket result = { 0.0, 0.0, 0.0, 0.0 };
+    bool empty = true;
+
+    if (level == 1) {
+        const int begin = int(qMax(from, m_first) - m_first);
+        const int end = int(qMin(to, m_first + m_keys.size()) - m_first);
+        for (int i = begin; i < end; ++i) {
+            const Bucket point = { m_keys.at(i), m_values.at(i), m_keys.at(i), m_values.at(i) };
+            if (empty) {
+                result = point;
+                empty = false;
+            } else {
+                merge(result, point);
+            }
+        }
+    } else {
+        const QVector<Bucket> &lower = m_levels.at(level - 2);
+        const qint64 lowerBase = levelBase(level - 1);
+        const int begin = int(qMax(from, lowerBase) - lowerBase);
+        const int end = int(qMin(to, lowerBase + lower.size()) - lowerBase);
+        for (int i = begin; i < end; ++i) {
+            if (empty) {
+                result = lower.at(i);
+                empty = false;
+            } else {
+                merge(result, lower.at(i));
+            }
+        }
+    }
+    return result;
+}
+
+void MinMaxPyramid::merge(Bucket &target, const Bucket &source)
+{
+    if (source.minValue < target.minValue) {
+        target.minValue = source.minValue;
+        target.minKey = source.minKey;
+    }
+    if (source.maxValue > target.maxValue) {
+        target.maxValue = source.maxValue;
+        target.maxKey = source.maxKey;
+    }
+}
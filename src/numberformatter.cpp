@@ -0,0 +1,134 @@
+#include "numberformatter.h"
+#include <QVector>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QtNumeric>
+#include <random>
+
+namespace {
+
+const double Powers[NumberFormatter::MaxDecimals + 1] = {
+    1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0, 10000000.0, 100000000.0
+};
+
+// 放大后的值超过此范围时退回QString::number
+const double MaxScaled = 9.0e18;
+
+// 从个位向高位写入临时数组，再正序复制到buffer
+int writeDigits(quint64 magnitude, int decimals, bool negative, QChar *buffer)
+{
+    ushort digits[NumberFormatter::BufferSize];
+    int length = 0;
+    for (int i = 0; i < decimals; ++i) {
+        digits[length++] = ushort('0' + magnitude % 10);
+        magnitude /= 10;
+    }
+    if (decimals > 0) {
+        digits[length++] = '.';
+    }
+    do {
+        digits[length++] = ushort('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (negative) {
+        digits[length++] = '-';
+    }
+
+    for (int i = 0; i < length; ++i) {
+        buffer[i] = QChar(digits[length - 1 - i]);
+    }
+    return length;
+}
+
+} // namespace
+
+int NumberFormatter::formatFixed(double value, int decimals, QChar *buffer)
+{
+    decimals = qBound(0, decimals, int(MaxDecimals));
+    const double scaled = qAbs(value) * Powers[decimals] + 0.5;
+    if (!qIsFinite(value) || scaled >= MaxScaled) {
+        // 超出范围时用科学计数法，保证不超过BufferSize
+        const QString text = QString::number(value, 'g', 17);
+        const int length = qMin(text.size(), int(BufferSize));
+        for (int i = 0; i < length; ++i) {
+            buffer[i] = text.at(i);
+        }
+        return length;
+    }
+
+    const quint64 magnitude = quint64(scaled);
+    return writeDigits(magnitude, decimals, value < 0 && magnitude != 0, buffer);
+}
+
+int NumberFormatter::formatInteger(qint64 value, QChar *buffer)
+{
+    const quint64 magnitude = value < 0 ? 0 - quint64(value) : quint64(value);
+    return writeDigits(magnitude, 0, value < 0, buffer);
+}
+
+QString NumberFormatter::fixed(double value, int decimals)
+{
+    QChar buffer[BufferSize];
+    return QString(buffer, formatFixed(value, decimals, buffer));
+}
+
+QString NumberFormatter::integer(qint64 value)
+{
+    QChar buffer[BufferSize];
+    return QString(buffer, formatInteger(value, buffer));
+}
+
+int NumberFormatter::benchmark(int count)
+{
+    // 固定种子的随机价格
+    QVector<double> values(count);
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> price(1.0, 2000.0);
+    for (int i = 0; i < count; ++i) {
+        values[i] = price(random);
+    }
+
+    // 累加长度，避免循环被优化掉
+    qint64 checksum = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+    for (double value : qAsConst(values)) {
+        checksum += QString("%1").arg(value, 0, 'f', 2).size();
+    }
+    const qint64 argNs = timer.nsecsElapsed();
+
+    timer.restart();
+    for (double value : qAsConst(values)) {
+        checksum += QString::number(value, 'f', 2).size();
+    }
+    const qint64 numberNs = timer.nsecsElapsed();
+
+    timer.restart();
+    for (double value : qAsConst(values)) {
+        checksum += fixed(value, 2).size();
+    }
+    const qint64 fixedNs = timer.nsecsElapsed();
+
+    QChar buffer[BufferSize];
+    timer.restart();
+    for (double value : qAsConst(values)) {
+        checksum += formatFixed(value, 2, buffer);
+    }
+    const qint64 bufferNs = timer.nsecsElapsed();
+
+    int mismatches = 0;
+    for (double value : qAsConst(values)) {
+        if (fixed(value, 2) != QString::number(value, 'f', 2)) {
+            ++mismatches;
+        }
+    }
+
+    qInfo() << "数字格式化测试:" << count << "次, 两位小数";
+    qInfo().noquote() << QString("  QString::arg                  %1 ns/次").arg(double(argNs) / count, 0, 'f', 1);
+    qInfo().noquote() << QString("  QString::number               %1 ns/次").arg(double(numberNs) / count, 0, 'f', 1);
+    qInfo().noquote() << QString("  NumberFormatter::fixed        %1 ns/次").arg(double(fixedNs) / count, 0, 'f', 1);
+    qInfo().noquote() << QString("  NumberFormatter::formatFixed  %1 ns/次").arg(double(bufferNs) / count, 0, 'f', 1);
+    qInfo() << "  与QString::number结果不同:" << mismatches << "次, 校验和" << checksum;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,646 @@
+#include "quotetablemodel.h"
+#include "numberformatter.h"
+#include <QDateTime>
+#include <QColor>
+#include <QTimer>
+#include <QtAlgorithms>
+#include <QDebug>
+#include <algorithm>
+#include <climits>
+#include <random>
+
+namespace {
+
+// 值有变化时写入并记下该列
+template <typename T>
+void assign(QVector<T> &column, int row, const T &value, int bit, quint32 &changed)
+{
+    if (column.at(row) != value) {
+        column[row] = value;
+        changed |= 1u << bit;
+    }
+}
+
+} // namespace
+
+QuoteTableModel::QuoteTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+    , m_darkTheme(false)
+    , m_firstVisible(0)
+    , m_lastVisible(INT_MAX)
+    , m_sortColumn(-1)
+    , m_sortOrder(Qt::AscendingOrder)
+    , m_rangeColumn(-1)
+    , m_rangeMin(0)
+    , m_rangeMax(0)
+    , m_flashTimer(new QTimer(this))
+{
+    m_clock.start();
+    m_flashTimer->setInterval(FlashIntervalMs);
+    connect(m_flashTimer, &QTimer::timeout, this, &QuoteTableModel::onFlashTimer);
+    buildPalette();
+}
+
+void QuoteTableModel::setStockCodes(const QStringList &stockCodes)
+{
+    beginResetModel();
+    m_codes = stockCodes;
+    m_rows.clear();
+    m_rows.reserve(stockCodes.size());
+    for (int i = 0; i < stockCodes.size(); ++i) {
+        m_rows.insert(stockCodes.at(i), i);
+    }
+
+    const int rows = stockCodes.size();
+    m_names.fill(QString(), rows);
+    m_price.fill(0, rows);
+    m_change.fill(0, rows);
+    m_changePercent.fill(0, rows);
+    m_prevClose.fill(0, rows);
+    m_open.fill(0, rows);
+    m_volume.fill(0, rows);
+    m_outerDisc.fill(0, rows);
+    m_innerDisc.fill(0, rows);
+    m_time.fill(0, rows);
+    m_changedColumns.fill(0, rows);
+    m_textCache.fill(QString(), rows * ColumnCount);
+    m_pending.fill(false, rows);
+    m_pendingRows.clear();
+    m_flashStart.fill(0, rows);
+    m_flashUp.fill(0, rows);
+    m_flashRows.clear();
+    m_flashTimer->stop();
+    rebuildOrder();
+    endResetModel();
+}
+
+bool QuoteTableModel::setQuote(int row, const QStringList &parts)
+{
+    if (row < 0 || row >= m_codes.size() || parts.size() <= 9) {
+        return false;
+    }
+
+    // 已有行情的行价格变化时闪烁
+    const double price = parts.at(1).toDouble();
+    if (m_time.at(row) != 0 && price != m_price.at(row)) {
+        startFlash(row, price > m_price.at(row));
+    }
+
+    quint32 changed = 0;
+    assign(m_names, row, parts.at(0), NameColumn, changed);
+    assign(m_price, row, price, PriceColumn, changed);
+    assign(m_change, row, parts.at(2).toDouble(), ChangeColumn, changed);
+    assign(m_changePercent, row, parts.at(3).toDouble(), ChangePercentColumn, changed);
+    assign(m_prevClose, row, parts.at(4).toDouble(), PrevCloseColumn, changed);
+    assign(m_open, row, parts.at(5).toDouble(), OpenColumn, changed);
+    assign(m_volume, row, parts.at(6).toLongLong(), VolumeColumn, changed);
+    assign(m_outerDisc, row, parts.at(7).toLongLong(), OuterDiscColumn, changed);
+    assign(m_innerDisc, row, parts.at(8).toLongLong(), InnerDiscColumn, changed);
+    assign(m_time, row, parts.at(9).toLongLong(), TimeColumn, changed);
+
+    // 值有变化的单元格丢弃缓存的文字
+    for (quint32 bits = changed; bits != 0; bits &= bits - 1) {
+        m_textCache[row * ColumnCount + qCountTrailingZeroBits(bits)] = QString();
+    }
+
+    // 涨跌额决定三列的颜色；有新时间的行情会给走势追加新点
+    if (changed & (1u << ChangeColumn)) {
+        changed |= (1u << PriceColumn) | (1u << ChangePercentColumn);
+    }
+    if (changed & (1u << TimeColumn)) {
+        changed |= 1u << TrendColumn;
+    }
+    if (changed == 0) {
+        return false;
+    }
+
+    // 排序键或筛选用到的列有变化时，等下一帧重新定位
+    quint32 keyColumns = 0;
+    if (m_sortColumn >= 0) {
+        keyColumns |= 1u << m_sortColumn;
+    }
+    if (m_rangeColumn >= 0) {
+        keyColumns |= 1u << m_rangeColumn;
+    }
+    if (!m_textFilter.isEmpty()) {
+        keyColumns |= 1u << NameColumn;
+    }
+    bool needsMove = false;
+    if ((changed & keyColumns) && !m_pending.at(row)) {
+        m_pending[row] = true;
+        m_pendingRows.append(row);
+        needsMove = true;
+    }
+
+    if (!isRowVisible(row)) {
+        return needsMove;
+    }
+    m_changedColumns[row] |= changed;
+    return true;
+}
+
+void QuoteTableModel::commitRow(int row)
+{
+    if (row < 0 || row >= m_changedColumns.size()) {
+        return;
+    }
+
+    const quint32 changed = m_changedColumns.at(row);
+    const int position = m_position.at(row);
+    if (changed == 0 || position < 0) {
+        return;
+    }
+    m_changedColumns[row] = 0;
+
+    // 变化列的最小范围，视图只重绘这些单元格
+    const int first = qCountTrailingZeroBits(changed);
+    const int last = 31 - qCountLeadingZeroBits(changed);
+    emit dataChanged(index(position, first), index(position, last));
+}
+
+void QuoteTableModel::applyPendingMoves()
+{
+    if (m_pendingRows.isEmpty()) {
+        return;
+    }
+
+    // 不再满足筛选条件的行
+    for (int row : qAsConst(m_pendingRows)) {
+        const int position = m_position.at(row);
+        if (position >= 0 && !acceptsRow(row)) {
+            beginRemoveRows(QModelIndex(), position, position);
+            m_order.remove(position);
+            m_position[row] = -1;
+            updatePositions(position, m_order.size() - 1);
+            endRemoveRows();
+        }
+    }
+
+    // 逐行移到新位置，视图只移动这一行，位置表只更新移动跨过的范围
+    for (int row : qAsConst(m_pendingRows)) {
+        const int from = m_position.at(row);
+        if (from < 0) {
+            continue;
+        }
+
+        // 目标是移动前的下标，等于from或from+1时位置不变
+        const int target = insertPosition(row);
+        m_pending[row] = false;
+        if (target == from || target == from + 1) {
+            continue;
+        }
+
+        beginMoveRows(QModelIndex(), from, from, QModelIndex(), target);
+        if (target < from) {
+            std::rotate(m_order.begin() + target, m_order.begin() + from, m_order.begin() + from + 1);
+            updatePositions(target, from);
+        } else {
+            std::rotate(m_order.begin() + from, m_order.begin() + from + 1, m_order.begin() + target);
+            updatePositions(from, target - 1);
+        }
+        endMoveRows();
+    }
+
+    // 新满足筛选条件的行
+    for (int row : qAsConst(m_pendingRows)) {
+        if (m_position.at(row) < 0 && acceptsRow(row)) {
+            auto it = std::lower_bound(m_order.begin(), m_order.end(), row,
+                                       [this](int left, int right) { return lessThan(left, right); });
+            const int position = int(it - m_order.begin());
+            beginInsertRows(QModelIndex(), position, position);
+            m_order.insert(position, row);
+            updatePositions(position, m_order.size() - 1);
+            endInsertRows();
+        }
+        m_pending[row] = false;
+    }
+
+    m_pendingRows.clear();
+}
+
+void QuoteTableModel::sort(int column, Qt::SortOrder order)
+{
+    // 走势列没有可比较的值，按自选股列表的顺序
+    if (column < 0 || column >= TrendColumn) {
+        column = -1;
+    }
+
+    emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+    const QModelIndexList persistent = persistentIndexList();
+    const QVector<int> persistentSources = persistentRows(persistent);
+
+    m_sortColumn = column;
+    m_sortOrder = order;
+    rebuildOrder();
+
+    restorePersistent(persistent, persistentSources);
+    emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
+
+void QuoteTableModel::setTextFilter(const QString &text)
+{
+    if (m_textFilter == text) {
+        return;
+    }
+
+    beginResetModel();
+    m_textFilter = text;
+    rebuildOrder();
+    endResetModel();
+}
+
+void QuoteTableModel::setRangeFilter(int column, double min, double max)
+{
+    if (column < PriceColumn || column > TimeColumn) {
+        column = -1;
+    }
+    if (m_rangeColumn == column && m_rangeMin == min && m_rangeMax == max) {
+        return;
+    }
+
+    beginResetModel();
+    m_rangeColumn = column;
+    m_rangeMin = min;
+    m_rangeMax = max;
+    rebuildOrder();
+    endResetModel();
+}
+
+void QuoteTableModel::setDarkTheme(bool dark)
+{
+    if (m_darkTheme == dark) {
+        return;
+    }
+
+    m_darkTheme = dark;
+    buildPalette();
+    if (!m_order.isEmpty()) {
+        emit dataChanged(index(0, PriceColumn), index(m_order.size() - 1, ChangePercentColumn),
+                         {Qt::ForegroundRole, Qt::BackgroundRole});
+    }
+}
+
+void QuoteTableModel::startFlash(int row, bool up)
+{
+    if (m_flashStart.at(row) == 0) {
+        m_flashRows.append(row);
+    }
+    // 0表示不在闪烁，时钟刚启动时也不能记为0
+    m_flashStart[row] = qMax<qint64>(1, m_clock.elapsed());
+    m_flashUp[row] = up;
+
+    if (!m_flashTimer->isActive()) {
+        m_flashTimer->start();
+    }
+}
+
+void QuoteTableModel::onFlashTimer()
+{
+    // 推进所有闪烁中的行，只通知视口内的行
+    const qint64 now = m_clock.elapsed();
+    for (int i = m_flashRows.size() - 1; i >= 0; --i) {
+        const int row = m_flashRows.at(i);
+        if (now - m_flashStart.at(row) >= FlashMs) {
+            m_flashStart[row] = 0;
+            m_flashRows[i] = m_flashRows.last();
+            m_flashRows.removeLast();
+        }
+
+        const int position = m_position.at(row);
+        if (position >= m_firstVisible && position <= m_lastVisible) {
+            emit dataChanged(index(position, PriceColumn), index(position, ChangePercentColumn),
+                             {Qt::BackgroundRole});
+        }
+    }
+
+    if (m_flashRows.isEmpty()) {
+        m_flashTimer->stop();
+    }
+}
+
+void QuoteTableModel::buildPalette()
+{
+    // 涨为红色，跌为绿色，深色主题用浅一些的颜色
+    m_upColor = m_darkTheme ? QColor(255, 100, 100) : QColor(Qt::red);
+    m_downColor = m_darkTheme ? QColor(100, 255, 100) : QColor(Qt::green);
+
+    // 第0级最淡，最后一级是刚开始闪烁时的颜色
+    const int maxAlpha = m_darkTheme ? 110 : 90;
+    for (int level = 0; level < FlashLevels; ++level) {
+        QColor up(m_upColor);
+        QColor down(m_downColor);
+        up.setAlpha(maxAlpha * (level + 1) / FlashLevels);
+        down.setAlpha(maxAlpha * (level + 1) / FlashLevels);
+        m_flashUpBrushes[level] = QBrush(up);
+        m_flashDownBrushes[level] = QBrush(down);
+    }
+}
+
+void QuoteTableModel::setVisibleRows(int first, int last)
+{
+    m_firstVisible = first;
+    m_lastVisible = last;
+}
+
+double QuoteTableModel::numericValue(int row, int column) const
+{
+    switch (column) {
+    case PriceColumn:
+        return m_price.at(row);
+    case ChangeColumn:
+        return m_change.at(row);
+    case ChangePercentColumn:
+        return m_changePercent.at(row);
+    case PrevCloseColumn:
+        return m_prevClose.at(row);
+    case OpenColumn:
+        return m_open.at(row);
+    case VolumeColumn:
+        return m_volume.at(row);
+    case OuterDiscColumn:
+        return m_outerDisc.at(row);
+    case InnerDiscColumn:
+        return m_innerDisc.at(row);
+    case TimeColumn:
+        return m_time.at(row);
+    default:
+        return 0;
+    }
+}
+
+bool QuoteTableModel::lessThan(int left, int right) const
+{
+    // 值相同时按序号，保证顺序唯一，二分插入的位置确定
+    int result = 0;
+    if (m_sortColumn == CodeColumn) {
+        result = m_codes.at(left).compare(m_codes.at(right));
+    } else if (m_sortColumn == NameColumn) {
+        result = m_names.at(left).compare(m_names.at(right));
+    } else if (m_sortColumn > NameColumn) {
+        const double a = numericValue(left, m_sortColumn);
+        const double b = numericValue(right, m_sortColumn);
+        result = a < b ? -1 : (a > b ? 1 : 0);
+    }
+
+    if (result == 0) {
+        return left < right;
+    }
+    return m_sortOrder == Qt::AscendingOrder ? result < 0 : result > 0;
+}
+
+bool QuoteTableModel::acceptsRow(int row) const
+{
+    if (!m_textFilter.isEmpty()
+        && !m_codes.at(row).contains(m_textFilter, Qt::CaseInsensitive)
+        && !m_names.at(row).contains(m_textFilter, Qt::CaseInsensitive)) {
+        return false;
+    }
+
+    if (m_rangeColumn >= 0) {
+        // 还没有行情的行不参与数值筛选
+        if (m_time.at(row) == 0) {
+            return false;
+        }
+        const double value = numericValue(row, m_rangeColumn);
+        return value >= m_rangeMin && value <= m_rangeMax;
+    }
+    return true;
+}
+
+void QuoteTableModel::rebuildOrder()
+{
+    m_order.clear();
+    m_order.reserve(m_codes.size());
+    for (int row = 0; row < m_codes.size(); ++row) {
+        if (acceptsRow(row)) {
+            m_order.append(row);
+        }
+    }
+    if (m_sortColumn >= 0) {
+        std::sort(m_order.begin(), m_order.end(),
+                  [this](int left, int right) { return lessThan(left, right); });
+    }
+
+    m_position.fill(-1, m_codes.size());
+    updatePositions(0, m_order.size() - 1);
+}
+
+int QuoteTableModel::insertPosition(int row) const
+{
+    // 尚未重新定位的行排序键已变，位置不可靠，二分时跳到其后第一个已定位的行比较。
+    // 这些行之外的行仍然有序，结果等同于在它们中做lower_bound
+    int low = 0;
+    int high = m_order.size();
+    while (low < high) {
+        const int mid = low + (high - low) / 2;
+        int probe = mid;
+        while (probe < high && m_pending.at(m_order.at(probe))) {
+            ++probe;
+        }
+        if (probe < high && lessThan(m_order.at(probe), row)) {
+            low = probe + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void QuoteTableModel::updatePositions(int first, int last)
+{
+    for (int position = first; position <= last; ++position) {
+        m_position[m_order.at(position)] = position;
+    }
+}
+
+QVector<int> QuoteTableModel::persistentRows(const QModelIndexList &indexes) const
+{
+    QVector<int> rows;
+    rows.reserve(indexes.size());
+    for (const QModelIndex &index : indexes) {
+        rows.append(m_order.at(index.row()));
+    }
+    return rows;
+}
+
+void QuoteTableModel::restorePersistent(const QModelIndexList &indexes, const QVector<int> &rows)
+{
+    // 选中行等持久索引跟随股票移动
+    QModelIndexList moved;
+    moved.reserve(indexes.size());
+    for (int i = 0; i < indexes.size(); ++i) {
+        const int position = m_position.at(rows.at(i));
+        moved.append(position >= 0 ? index(position, indexes.at(i).column()) : QModelIndex());
+    }
+    changePersistentIndexList(indexes, moved);
+}
+
+int QuoteTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_order.size();
+}
+
+int QuoteTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant QuoteTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_order.size()) {
+        return QVariant();
+    }
+
+    const int row = m_order.at(index.row());
+    const int column = index.column();
+    const bool hasQuote = m_time.at(row) != 0;
+
+    if (role == StockCodeRole) {
+        return m_codes.at(row);
+    }
+
+    if (role == Qt::ForegroundRole) {
+        if (!hasQuote || column < PriceColumn || column > ChangePercentColumn) {
+            return QVariant();
+        }
+        return m_change.at(row) >= 0 ? m_upColor : m_downColor;
+    }
+
+    if (role == Qt::BackgroundRole) {
+        const qint64 start = m_flashStart.at(row);
+        if (start == 0 || column < PriceColumn || column > ChangePercentColumn) {
+            return QVariant();
+        }
+        const qint64 remaining = FlashMs - (m_clock.elapsed() - start);
+        if (remaining <= 0) {
+            return QVariant();
+        }
+        const int level = qMin<int>(FlashLevels - 1, remaining * FlashLevels / FlashMs);
+        return m_flashUp.at(row) ? m_flashUpBrushes[level] : m_flashDownBrushes[level];
+    }
+
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    // 显示文字只在视图需要时生成，值不变时直接用缓存
+    if (column == TrendColumn) {
+        return QVariant();
+    }
+    if (!hasQuote && column != CodeColumn) {
+        return QStringLiteral("--");
+    }
+    QString &text = m_textCache[row * ColumnCount + column];
+    if (text.isNull()) {
+        text = formatCell(row, column);
+    }
+    return text;
+}
+
+QString QuoteTableModel::formatCell(int row, int column) const
+{
+    switch (column) {
+    case CodeColumn:
+        return m_codes.at(row).mid(2); // 去掉"v_"前缀
+    case NameColumn:
+        return m_names.at(row);
+    case PriceColumn:
+        return NumberFormatter::fixed(m_price.at(row), 2);
+    case ChangeColumn:
+        return NumberFormatter::fixed(m_change.at(row), 2);
+    case ChangePercentColumn:
+        return NumberFormatter::fixed(m_changePercent.at(row), 2);
+    case PrevCloseColumn:
+        return NumberFormatter::fixed(m_prevClose.at(row), 2);
+    case OpenColumn:
+        return NumberFormatter::fixed(m_open.at(row), 2);
+    case VolumeColumn:
+        return NumberFormatter::integer(m_volume.at(row));
+    case OuterDiscColumn:
+        return NumberFormatter::integer(m_outerDisc.at(row));
+    case InnerDiscColumn:
+        return NumberFormatter::integer(m_innerDisc.at(row));
+    case TimeColumn:
+        return QDateTime::fromMSecsSinceEpoch(m_time.at(row)).toString("hh:mm:ss");
+    default:
+        return QString();
+    }
+}
+
+QVariant QuoteTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    static const char *const headers[ColumnCount] = {
+        "股票代码", "名称", "当前价", "涨跌额", "涨跌幅(%)", "昨收价",
+        "开盘价", "成交量", "外盘", "内盘", "更新时间", "走势"
+    };
+    if (section < 0 || section >= ColumnCount) {
+        return QVariant();
+    }
+    return QString::fromUtf8(headers[section]);
+}
+
+int QuoteTableModel::benchmark(int rows, int frames)
+{
+    QStringList codes;
+    codes.reserve(rows);
+    for (int i = 0; i < rows; ++i) {
+        codes.append(QString("sh%1").arg(600000 + i));
+    }
+
+    QuoteTableModel model;
+    model.setStockCodes(codes);
+
+    // 固定种子的随机行情，字段顺序与HttpHelper::parseSinaData()一致
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> percent(-10.0, 10.0);
+    qint64 time = QDateTime::currentMSecsSinceEpoch();
+    auto quote = [&](int row) {
+        const double changePercent = percent(random);
+        const double price = 10.0 * (1 + changePercent / 100);
+        model.setQuote(row, { codes.at(row), QString::number(price, 'f', 2),
+                              QString::number(price - 10.0, 'f', 2), QString::number(changePercent, 'f', 2),
+                              "10.00", "10.00", "1000", "500", "500", QString::number(time) });
+    };
+
+    for (int row = 0; row < rows; ++row) {
+        quote(row);
+    }
+    model.sort(ChangePercentColumn, Qt::DescendingOrder);
+
+    const int perFrame = qMax(1, rows / 10);
+    std::uniform_int_distribution<int> pick(0, rows - 1);
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+    QElapsedTimer timer;
+    for (int frame = 0; frame < frames; ++frame) {
+        time += 1000;
+        for (int i = 0; i < perFrame; ++i) {
+            quote(pick(random));
+        }
+
+        timer.start();
+        model.applyPendingMoves();
+        const qint64 elapsed = timer.nsecsElapsed();
+        totalNs += elapsed;
+        maxNs = qMax(maxNs, elapsed);
+    }
+
+    // 逐行移动后的排列须与整体排序一致
+    bool sorted = true;
+    for (int position = 1; position < model.m_order.size(); ++position) {
+        if (model.lessThan(model.m_order.at(position), model.m_order.at(position - 1))) {
+            sorted = false;
+            break;
+        }
+    }
+
+    qInfo() << "表格排序测试:" << rows << "行," << frames << "帧, 每帧更新" << perFrame << "行";
+    qInfo().noquote() << QString("  applyPendingMoves  平均 %1 ms/帧, 最长 %2 ms")
+                         .arg(totalNs / 1e6 / frames, 0, 'f', 3).arg(maxNs / 1e6, 0, 'f', 3);
+    qInfo() << "  排列有序:" << sorted;
+    return sorted ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include "renderscheduler.h"
+#include <QTimer>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// 合并统计的输出间隔
+const int ReportIntervalMs = 10000;
+
+} // namespace
+
+RenderScheduler::RenderScheduler(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+    , m_maxFps(60)
+    , m_chartDirty(false)
+    , m_requests(0)
+    , m_flushed(0)
+    , m_frames(0)
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &RenderScheduler::flush);
+    m_sinceReport.start();
+}
+
+void RenderScheduler::setMaxFps(int fps)
+{
+    m_maxFps = qBound(1, fps, 240);
+}
+
+void RenderScheduler::markChartDirty()
+{
+    ++m_requests;
+    m_chartDirty = true;
+    schedule();
+}
+
+void RenderScheduler::markRowDirty(int row)
+{
+    ++m_requests;
+    m_dirtyRows.insert(row);
+    schedule();
+}
+
+void RenderScheduler::schedule()
+{
+    if (m_timer->isActive()) {
+        return;
+    }
+
+    // 距上一帧不足一帧时间时等到下一帧，否则在回到事件循环后立即刷新
+    const int frameMs = 1000 / m_maxFps;
+    int delay = 0;
+    if (m_sinceFlush.isValid()) {
+        delay = qMax(0, frameMs - int(m_sinceFlush.elapsed()));
+    }
+    m_timer->start(delay);
+}
+
+void RenderScheduler::flush()
+{
+    const bool chartDirty = m_chartDirty;
+    QList<int> rows = m_dirtyRows.values();
+    std::sort(rows.begin(), rows.end());
+    m_chartDirty = false;
+    m_dirtyRows.clear();
+
+    m_sinceFlush.start();
+    ++m_frames;
+    m_flushed += rows.size() + (chartDirty ? 1 : 0);
+
+    emit frame(chartDirty, rows);
+
+    if (m_sinceReport.elapsed() >= ReportIntervalMs) {
+        qDebug() << "界面刷新:" << m_frames << "帧," << m_requests << "次更新请求合并为"
+                 << m_flushed << "次刷新";
+        m_requests = 0;
+        m_flushed = 0;
+        m_frames = 0;
+        m_sinceReport.restart();
+    }
+}
@@ -0,0 +1,423 @@
+#include "retentionmanager.h"
+#include "databasehelper.h"
+#include "barbuilder.h"
+#include "tickpartitions.h"
+#include <QTimer>
+#include <QSettings>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QDebug>
+#include <QPair>
+
+namespace {
+
+const qint64 DayMs = 86400000LL;
+
+// 每轮清理的时间预算，超出后把剩余股票留给下一轮
+const int StepBudgetMs = 200;
+
+// 有积压时两轮清理之间的间隔
+const int BacklogIntervalMs = 1000;
+
+// ini中的K线周期键名
+const QList<QPair<int, QString>> &barDayKeys()
+{
+    static const QList<QPair<int, QString>> keys = {
+        { 60, "bar_1m_days" },
+        { 300, "bar_5m_days" },
+        { 3600, "bar_1h_days" },
+        { 86400, "bar_1d_days" },
+    };
+    return keys;
+}
+
+// 归档库按月分区：<数据目录>/archive/ticks_yyyyMM.db
+QString archivePath(qint64 dayStart)
+{
+    QFileInfo dbInfo(DatabaseHelper::instance().databasePath());
+    return dbInfo.absolutePath() + "/archive/ticks_"
+           + QDateTime::fromMSecsSinceEpoch(dayStart).toString("yyyyMM") + ".db";
+}
+
+// 处理一只股票最早的一天过期tick：补齐K线后归档或删除
+bool compactOldestDay(QSqlDatabase &db, const QString &stockCode, qint64 cutoff, bool archive,
+                      qint64 &removed, bool &moreDays)
+{
+    removed = 0;
+    moreDays = false;
+
+    qint64 oldest = 0;
+    {
+        QSqlQuery query(db);
+        query.prepare("SELECT MIN(timestamp) FROM stock_data WHERE stock_code = ?");
+        query.addBindValue(stockCode);
+        if (!query.exec() || !query.next() || query.value(0).isNull()) {
+            return true;
+        }
+        oldest = query.value(0).toLongLong();
+    }
+
+    if (oldest >= cutoff) {
+        return true;
+    }
+
+    qint64 dayStart = BarBuilder::alignTimestamp(oldest, DayMs, BarBuilder::localUtcOffsetMs());
+    qint64 dayEnd = qMin(dayStart + DayMs, cutoff);
+    moreDays = dayEnd < cutoff;
+
+    // 先在事务外聚合，写事务只包含写入
+    QVector<QVector<StockBar>> bars;
+    if (!DatabaseHelper::aggregateTicks(db, stockCode, dayStart, dayEnd, bars, "main.stock_data")) {
+        return false;
+    }
+
+    // ATTACH 不能在事务中执行
+    bool attached = false;
+    if (archive) {
+        QString path = archivePath(dayStart);
+        QDir().mkpath(QFileInfo(path).absolutePath());
+
+        if (!DatabaseHelper::attachDatabase(db, path, "archive")) {
+            return false;
+        }
+        attached = true;
+
+        QSqlQuery query(db);
+        if (!query.exec("CREATE TABLE IF NOT EXISTS archive.stock_data AS SELECT * FROM main.stock_data WHERE 0")
+            || !query.exec("CREATE INDEX IF NOT EXISTS archive.idx_stock_code_timestamp "
+                           "ON stock_data(stock_code, timestamp)")) {
+            qDebug() << "创建归档表失败:" << query.lastError().text();
+        }
+    }
+
+    bool success = db.transaction();
+
+    // 已有的增量K线更准确，只补齐缺失的部分
+    if (success) {
+        success = DatabaseHelper::writeBars(db, stockCode, bars, false);
+    }
+
+    if (success && archive) {
+        QSqlQuery query(db);
+        query.prepare("INSERT INTO archive.stock_data SELECT * FROM main.stock_data "
+                      "WHERE stock_code = ? AND timestamp >= ? AND timestamp < ?");
+        query.addBindValue(stockCode);
+        query.addBindValue(dayStart);
+        query.addBindValue(dayEnd);
+        success = query.exec();
+        if (!success) {
+            qDebug() << "归档tick失败:" << stockCode << query.lastError().text();
+        }
+    }
+
+    if (success) {
+        QSqlQuery query(db);
+        query.prepare("DELETE FROM main.stock_data "
+                      "WHERE stock_code = ? AND timestamp >= ? AND timestamp < ?");
+        query.addBindValue(stockCode);
+        query.addBindValue(dayStart);
+        query.addBindValue(dayEnd);
+        success = query.exec();
+        if (success) {
+            removed = query.numRowsAffected();
+        }
+        else {
+            qDebug() << "删除过期tick失败:" << stockCode << query.lastError().text();
+        }
+    }
+
+    if (success) {
+        success = db.commit();
+    }
+
+    if (!success) {
+        db.rollback();
+        removed = 0;
+    }
+
+    if (attached) {
+        DatabaseHelper::detachDatabase(db, "archive");
+    }
+
+    return success;
+}
+
+// 分区模式下退役最早的一个过期分区。分区内混有各分组的tick，按所有分组中最长的保留期计算
+bool retireOldestPartition(QSqlDatabase &db, const QList<RetentionPolicy> &policies, qint64 now,
+                           qint64 &removed, bool &morePartitions)
+{
+    removed = 0;
+    morePartitions = false;
+
+    int rawDays = 0;
+    bool archive = false;
+    for (const RetentionPolicy &policy : policies) {
+        // 有分组永久保留tick时分区不能整体退役
+        if (policy.rawDays <= 0) {
+            return false;
+        }
+        rawDays = qMax(rawDays, policy.rawDays);
+        archive = archive || policy.archive;
+    }
+
+    if (rawDays == 0) {
+        return false;
+    }
+
+    qint64 cutoff = now - rawDays * DayMs;
+    const QList<TickPartitions::Partition> expired = TickPartitions::endedBefore(db, cutoff, 2);
+    if (expired.isEmpty()) {
+        return false;
+    }
+
+    if (!TickPartitions::retirePartition(db, expired.first(), archive)) {
+        return false;
+    }
+
+    removed = expired.first().rowCount;
+    morePartitions = expired.size() > 1;
+    return true;
+}
+
+// 删除超过保留期的K线
+void purgeBars(QSqlDatabase &db, const QString &stockCode, const RetentionPolicy &policy, qint64 now)
+{
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM stock_bars WHERE stock_code = ? AND interval_sec = ? AND bar_time < ?");
+
+    for (auto it = policy.barDays.cbegin(); it != policy.barDays.cend(); ++it) {
+        if (it.value() <= 0) {
+            continue;
+        }
+
+        query.bindValue(0, stockCode);
+        query.bindValue(1, it.key());
+        query.bindValue(2, now - it.value() * DayMs);
+        if (!query.exec()) {
+            qDebug() << "删除过期K线失败:" << stockCode << query.lastError().text();
+        }
+    }
+}
+
+} // namespace
+
+RetentionManager::RetentionManager(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+    , m_idleIntervalMs(60000)
+    , m_enabled(false)
+    , m_running(false)
+{
+    m_pool.setMaxThreadCount(1);
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &RetentionManager::runStep);
+
+    // 默认策略：tick保留30天并归档，1分钟K线保留一年，其余周期永久保留
+    RetentionPolicy defaultPolicy;
+    defaultPolicy.group = "default";
+    defaultPolicy.barDays.insert(60, 365);
+    m_policies.append(defaultPolicy);
+}
+
+RetentionManager::~RetentionManager()
+{
+    stop();
+    m_pool.waitForDone();
+}
+
+bool RetentionManager::loadPolicies(const QString &fileName)
+{
+    QSettings settings(fileName, QSettings::IniFormat);
+
+    // 首次运行时写入默认策略，方便用户按分组修改
+    if (!QFile::exists(fileName)) {
+        for (const RetentionPolicy &policy : m_policies) {
+            settings.beginGroup(policy.group);
+            settings.setValue("prefixes", policy.prefixes);
+            settings.setValue("raw_days", policy.rawDays);
+            for (const auto &key : barDayKeys()) {
+                settings.setValue(key.second, policy.barDays.value(key.first, 0));
+            }
+            settings.setValue("archive", policy.archive);
+            settings.endGroup();
+        }
+        settings.sync();
+        return settings.status() == QSettings::NoError;
+    }
+
+    QList<RetentionPolicy> policies;
+    for (const QString &group : settings.childGroups()) {
+        settings.beginGroup(group);
+        RetentionPolicy policy;
+        policy.group = group;
+        policy.prefixes = settings.value("prefixes").toStringList();
+        policy.prefixes.removeAll(QString());
+        policy.rawDays = settings.value("raw_days", policy.rawDays).toInt();
+        for (const auto &key : barDayKeys()) {
+            int days = settings.value(key.second, 0).toInt();
+            if (days > 0) {
+                policy.barDays.insert(key.first, days);
+            }
+        }
+        policy.archive = settings.value("archive", policy.archive).toBool();
+        settings.endGroup();
+        policies.append(policy);
+    }
+
+    if (settings.status() != QSettings::NoError || policies.isEmpty()) {
+        qWarning() << "无法加载数据保留策略:" << fileName;
+        return false;
+    }
+
+    setPolicies(policies);
+    return true;
+}
+
+void RetentionManager::setPolicies(const QList<RetentionPolicy> &policies)
+{
+    m_policies = policies;
+}
+
+const RetentionPolicy &RetentionManager::matchPolicy(const QList<RetentionPolicy> &policies,
+                                                     const QString &stockCode)
+{
+    static const RetentionPolicy fallback;
+
+    const RetentionPolicy *defaultPolicy = nullptr;
+    const RetentionPolicy *best = nullptr;
+    int bestLength = -1;
+
+    for (const RetentionPolicy &policy : policies) {
+        if (policy.prefixes.isEmpty()) {
+            if (!defaultPolicy) {
+                defaultPolicy = &policy;
+            }
+            continue;
+        }
+
+        for (const QString &prefix : policy.prefixes) {
+            if (prefix.length() > bestLength && stockCode.startsWith(prefix)) {
+                best = &policy;
+                bestLength = prefix.length();
+            }
+        }
+    }
+
+    if (best) {
+        return *best;
+    }
+    return defaultPolicy ? *defaultPolicy : fallback;
+}
+
+void RetentionManager::start(int idleIntervalMs)
+{
+    m_idleIntervalMs = idleIntervalMs;
+    m_enabled = true;
+    if (!m_running) {
+        m_timer->start(0);
+    }
+}
+
+void RetentionManager::stop()
+{
+    m_enabled = false;
+    m_timer->stop();
+}
+
+void RetentionManager::runStep()
+{
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+
+    QList<RetentionPolicy> policies = m_policies;
+    StepState state = m_state;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    m_pool.start(QRunnable::create([this, policies, state, now]() mutable {
+        executeStep(policies, state, now);
+        QMetaObject::invokeMethod(this, [this, state]() {
+            onStepFinished(state);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void RetentionManager::executeStep(const QList<RetentionPolicy> &policies, StepState &state, qint64 now)
+{
+    state.compactedDays = 0;
+    state.removedTicks = 0;
+    state.backlog = false;
+
+    DatabaseHelper::Connection connection("retention");
+    if (!connection.isOpen()) {
+        return;
+    }
+
+    QSqlDatabase db = connection.database();
+
+    // 新一轮开始时重新获取股票列表
+    if (state.cursor >= state.codes.size()) {
+        state.codes = DatabaseHelper::listStockCodes(db);
+        state.cursor = 0;
+    }
+
+    const qint64 utcOffsetMs = BarBuilder::localUtcOffsetMs();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 分区模式下新tick不再写入主库，过期分区整体退役，主库中只剩切换前的数据按股票清理
+    if (DatabaseHelper::instance().isPartitioned()) {
+        qint64 removed = 0;
+        bool morePartitions = false;
+        if (retireOldestPartition(db, policies, now, removed, morePartitions)) {
+            ++state.compactedDays;
+            state.removedTicks += removed;
+        }
+        state.backlog = morePartitions;
+    }
+
+    while (state.cursor < state.codes.size() && timer.elapsed() < StepBudgetMs) {
+        const QString stockCode = state.codes.at(state.cursor++);
+        const RetentionPolicy &policy = matchPolicy(policies, stockCode);
+
+        if (policy.rawDays > 0) {
+            // 只清理完整的自然日，保证被删除的tick所在的各周期K线都已收盘
+            qint64 cutoff = BarBuilder::alignTimestamp(now - policy.rawDays * DayMs, DayMs, utcOffsetMs);
+            qint64 removed = 0;
+            bool moreDays = false;
+            if (compactOldestDay(db, stockCode, cutoff, policy.archive, removed, moreDays) && removed > 0) {
+                ++state.compactedDays;
+                state.removedTicks += removed;
+            }
+            state.backlog = state.backlog || moreDays;
+        }
+
+        purgeBars(db, stockCode, policy, now);
+    }
+
+    if (state.cursor < state.codes.size()) {
+        state.backlog = true;
+    }
+}
+
+void RetentionManager::onStepFinished(const StepState &state)
+{
+    m_running = false;
+    m_state = state;
+
+    if (state.compactedDays > 0) {
+        qDebug() << "数据保留清理:" << state.compactedDays << "天," << state.removedTicks << "笔tick";
+    }
+    emit stepFinished(state.compactedDays, state.removedTicks, state.backlog);
+
+    // 有积压时尽快继续，否则等待下一个周期
+    if (m_enabled) {
+        m_timer->start(state.backlog ? BacklogIntervalMs : m_idleIntervalMs);
+    }
+}
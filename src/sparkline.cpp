@@ -0,0 +1,55 @@
+#include "sparkline.h"
+
+void Sparkline::buildPath(const QVector<double> &keys, const QVector<double> &values,
+                          const QRect &rect, QVector<QPointF> &points)
+{
+    points.clear();
+    const int count = qMin(keys.size(), values.size());
+    if (count < 2 || rect.width() < 2 || rect.height() < 2) {
+        return;
+    }
+
+    double minValue = values.first();
+    double maxValue = values.first();
+    for (int i = 0; i < count; ++i) {
+        minValue = qMin(minValue, values.at(i));
+        maxValue = qMax(maxValue, values.at(i));
+    }
+    const double valueSpan = qMax(maxValue - minValue, 1e-9);
+    const double keySpan = qMax(keys.at(count - 1) - keys.first(), 1e-9);
+    const double xScale = (rect.width() - 1) / keySpan;
+    const double yScale = (rect.height() - 1) / valueSpan;
+
+    // 每个像素列最多两个点：该列的最小值和最大值
+    int column = -1;
+    double columnMin = 0.0;
+    double columnMax = 0.0;
+    auto flush = [&]() {
+        const double x = rect.left() + column;
+        points.append(QPointF(x, rect.bottom() - (columnMin - minValue) * yScale));
+        if (columnMax != columnMin) {
+            points.append(QPointF(x, rect.bottom() - (columnMax - minValue) * yScale));
+        }
+    };
+    for (int i = 0; i < count; ++i) {
+        const int x = int((keys.at(i) - keys.first()) * xScale);
+        const double value = values.at(i);
+        if (x != column) {
+            if (column >= 0) {
+                flush();
+            }
+            column = x;
+            columnMin = value;
+            columnMax = value;
+        } else {
+            columnMin = qMin(columnMin, value);
+            columnMax = qMax(columnMax, value);
+        }
+    }
+    flush();
+}
+
+QColor Sparkline::trendColor(double first, double last)
+{
+    return last >= first ? QColor(230, 60, 60) : QColor(40, 170, 80);
+}
@@ -0,0 +1,62 @@
+#include "sparklinedelegate.h"
+#include "timeseriesstore.h"
+#include "sparkline.h"
+#include "quotetablemodel.h"
+#include <QPainter>
+#include <QApplication>
+#include <QStyle>
+
+SparklineDelegate::SparklineDelegate(TimeSeriesStore *store, QObject *parent)
+    : QStyledItemDelegate(parent)
+    , m_store(store)
+{
+}
+
+void SparklineDelegate::invalidate(const QString &stockCode)
+{
+    m_cache.remove(stockCode);
+}
+
+void SparklineDelegate::invalidateAll()
+{
+    m_cache.clear();
+}
+
+void SparklineDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                              const QModelIndex &index) const
+{
+    // 先画选中、交替行等背景
+    QStyleOptionViewItem opt(option);
+    initStyleOption(&opt, index);
+    opt.text.clear();
+    QStyle *style = opt.widget ? opt.widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, opt.widget);
+
+    const QString stockCode = index.data(QuoteTableModel::StockCodeRole).toString();
+    if (stockCode.isEmpty()) {
+        return;
+    }
+
+    const QRect rect = option.rect.adjusted(2, 3, -2, -3);
+    const qreal ratio = painter->device() ? painter->device()->devicePixelRatioF() : 1.0;
+    const QSize pixelSize = rect.size() * ratio;
+
+    // 缓存失效或列宽变化时重新生成
+    QPixmap &pixmap = m_cache[stockCode];
+    if (pixmap.isNull() || pixmap.size() != pixelSize) {
+        pixmap = QPixmap(pixelSize);
+        pixmap.setDevicePixelRatio(ratio);
+        pixmap.fill(Qt::transparent);
+
+        TimeSeriesStore::Series *series = m_store->series(stockCode);
+        if (series && series->snapshot(m_keys, m_values) >= 2) {
+            Sparkline::buildPath(m_keys, m_values, QRect(QPoint(0, 0), rect.size()), m_points);
+            QPainter pixmapPainter(&pixmap);
+            pixmapPainter.setRenderHint(QPainter::Antialiasing);
+            pixmapPainter.setPen(QPen(Sparkline::trendColor(m_values.first(), m_values.last()), 1.2));
+            pixmapPainter.drawPolyline(m_points.constData(), m_points.size());
+        }
+    }
+
+    painter->drawPixmap(rect.topLeft(), pixmap);
+}
@@ -0,0 +1,57 @@
+#include "startupprofiler.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <QPair>
+#include <QDebug>
+
+namespace {
+
+QElapsedTimer &startupTimer()
+{
+    static QElapsedTimer timer;
+    return timer;
+}
+
+QVector<QPair<QString, qint64>> &startupMarks()
+{
+    static QVector<QPair<QString, qint64>> marks;
+    return marks;
+}
+
+} // namespace
+
+void StartupProfiler::start()
+{
+    startupTimer().start();
+    startupMarks().clear();
+}
+
+void StartupProfiler::mark(const QString &phase)
+{
+    if (!startupTimer().isValid()) {
+        return;
+    }
+
+    for (const auto &mark : qAsConst(startupMarks())) {
+        if (mark.first == phase) {
+            return;
+        }
+    }
+    startupMarks().append(qMakePair(phase, startupTimer().elapsed()));
+}
+
+qint64 StartupProfiler::elapsed()
+{
+    return startupTimer().isValid() ? startupTimer().elapsed() : 0;
+}
+
+void StartupProfiler::report()
+{
+    qint64 previous = 0;
+    qInfo() << "启动耗时:";
+    for (const auto &mark : qAsConst(startupMarks())) {
+        qInfo().noquote() << QString("  %1 ms (+%2 ms)  %3")
+                             .arg(mark.second, 6).arg(mark.second - previous, 5).arg(mark.first);
+        previous = mark.second;
+    }
+}
@@ -5,14 +5,66 @@
 #include <QPushButton>
 #include <QMainWindow>
 #include <QStyle>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QTableWidget>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QElapsedTimer>
+#include <QWindow>
 
 #include "qcustomplot.h"
 
+namespace {
+
+// 按颜色表生成调色板，未列出的立体效果颜色由QPalette从按钮色推算
+QPalette buildPalette(const QMap<QString, QColor>& colors)
+{
+    QPalette palette(colors.value("button"), colors.value("window"));
+    palette.setColor(QPalette::WindowText, colors.value("text"));
+    palette.setColor(QPalette::Base, colors.value("base"));
+    palette.setColor(QPalette::AlternateBase, colors.value("alternateBase"));
+    palette.setColor(QPalette::Text, colors.value("text"));
+    palette.setColor(QPalette::ButtonText, colors.value("text"));
+    palette.setColor(QPalette::Highlight, colors.value("highlight"));
+    palette.setColor(QPalette::HighlightedText, colors.value("text"));
+    palette.setColor(QPalette::ToolTipBase, colors.value("button"));
+    palette.setColor(QPalette::ToolTipText, colors.value("text"));
+    palette.setColor(QPalette::Mid, colors.value("border"));
+    palette.setColor(QPalette::Disabled, QPalette::WindowText, colors.value("border"));
+    palette.setColor(QPalette::Disabled, QPalette::Text, colors.value("border"));
+    palette.setColor(QPalette::Disabled, QPalette::ButtonText, colors.value("border"));
+    return palette;
+}
+
+// 旧的切换方式：逐个控件重新polish，只用于对比耗时
+void repolishAll(QWidget* widget)
+{
+    widget->style()->unpolish(widget);
+    widget->style()->polish(widget);
+    widget->update();
+
+    const QObjectList& children = widget->children();
+    for (QObject* child : children) {
+        if (QWidget* childWidget = qobject_cast<QWidget*>(child)) {
+            repolishAll(childWidget);
+        }
+    }
+}
+
+} // namespace
+
 ThemeManager::ThemeManager(QObject* parent)
     : QObject(parent)
     , m_currentTheme(ThemeType::Unkonw)
 {
     initializeColorMaps();
+    compileThemes();
+
+    // 部分平台的原生样式不按调色板绘制按钮和表头，统一使用Fusion
+    QApplication::setStyle("Fusion");
+    // main()在创建主窗口之前构造主题管理器，此时还没有控件，设置样式表不会触发重新polish
+    qApp->setStyleSheet(m_styleSheet);
 }
 
 ThemeManager& ThemeManager::instance()
@@ -56,82 +108,45 @@ QString ThemeManager::loadStyleSheet(const QString& fileName)
 
 void ThemeManager::applyCurrentTheme()
 {
-    QString styleSheet;
-    if (m_currentTheme == Dark) {
-        styleSheet = loadStyleSheet(":/resources/dark.qss");
-        qApp->setProperty("darkTheme", true);
-    } else {
-        styleSheet = loadStyleSheet(":/resources/light.qss");
-        qApp->setProperty("darkTheme", false);
-    }
+    // 替换应用程序调色板，没有单独设置调色板的控件收到通知后自行重绘
+    QApplication::setPalette(theme().palette);
 
-    qApp->setStyleSheet(styleSheet);
+    // 样式表着色的控件只按新的属性值重新匹配自身的规则，不递归到子控件
+    const bool dark = m_currentTheme == Dark;
+    for (QWidget* widget : qAsConst(m_styledWidgets)) {
+        if (widget && widget->property("darkTheme").toBool() != dark) {
+            widget->setProperty("darkTheme", dark);
+            widget->style()->unpolish(widget);
+            widget->style()->polish(widget);
+            widget->update();
+        }
+    }
 }
 
-void ThemeManager::updateWidgetStyle(QWidget* widget)
+void ThemeManager::addStyledWidget(QWidget* widget)
 {
     if (!widget) return;
 
-    // 强制更新样式
-    widget->style()->unpolish(widget);
-    widget->style()->polish(widget);
-    widget->update();
+    widget->setProperty("darkTheme", m_currentTheme == Dark);
+    m_styledWidgets.append(widget);
+}
 
+void ThemeManager::applyChartTheme(QCustomPlot* plot) const
+{
+    if (!plot) return;
 
-    // 如果是QCustomPlot，确保样式正确应用
-    if (QCustomPlot* customPlot = qobject_cast<QCustomPlot*>(widget)) {
-        if (m_currentTheme == Dark) {
-            // 深色主题
-            customPlot->setBackground(QBrush(QColor(43, 43, 43)));
-            customPlot->xAxis->setTickLabelColor(Qt::white);
-            customPlot->yAxis->setTickLabelColor(Qt::white);
-            customPlot->xAxis->setLabelColor(Qt::white);
-            customPlot->yAxis->setLabelColor(Qt::white);
-            customPlot->xAxis->setBasePen(QPen(Qt::white));
-            customPlot->yAxis->setBasePen(QPen(Qt::white));
-            customPlot->xAxis->setTickPen(QPen(Qt::white));
-            customPlot->yAxis->setTickPen(QPen(Qt::white));
-            customPlot->xAxis->setSubTickPen(QPen(Qt::white));
-            customPlot->yAxis->setSubTickPen(QPen(Qt::white));
-            customPlot->xAxis->grid()->setPen(QPen(QColor(80, 80, 80), 0, Qt::DotLine));
-            customPlot->yAxis->grid()->setPen(QPen(QColor(80, 80, 80), 0, Qt::DotLine));
-            
-            // 更新图表线条颜色
-            for (int i = 0; i < customPlot->graphCount(); ++i) {
-                customPlot->graph(i)->setPen(QPen(QColor(255, 100, 100), 2));
-            }
-        } else {
-            // 浅色主题
-            customPlot->setBackground(QBrush(QColor(255, 255, 255)));
-            customPlot->xAxis->setTickLabelColor(Qt::black);
-            customPlot->yAxis->setTickLabelColor(Qt::black);
-            customPlot->xAxis->setLabelColor(Qt::black);
-            customPlot->yAxis->setLabelColor(Qt::black);
-            customPlot->xAxis->setBasePen(QPen(Qt::black));
-            customPlot->yAxis->setBasePen(QPen(Qt::black));
-            customPlot->xAxis->setTickPen(QPen(Qt::black));
-            customPlot->yAxis->setTickPen(QPen(Qt::black));
-            customPlot->xAxis->setSubTickPen(QPen(Qt::black));
-            customPlot->yAxis->setSubTickPen(QPen(Qt::black));
-            customPlot->xAxis->grid()->setPen(QPen(QColor(200, 200, 200), 0, Qt::DotLine));
-            customPlot->yAxis->grid()->setPen(QPen(QColor(200, 200, 200), 0, Qt::DotLine));
-            
-            // 更新图表线条颜色
-            for (int i = 0; i < customPlot->graphCount(); ++i) {
-                customPlot->graph(i)->setPen(QPen(QColor(0, 102, 204), 2));
-            }
-        }
-        
-        // 重绘图表
-        customPlot->replot();
+    const Theme& current = theme();
+    plot->setBackground(current.chartBackground);
+    for (QCPAxis* axis : {plot->xAxis, plot->yAxis}) {
+        axis->setTickLabelColor(current.chartText);
+        axis->setLabelColor(current.chartText);
+        axis->setBasePen(current.axisPen);
+        axis->setTickPen(current.axisPen);
+        axis->setSubTickPen(current.axisPen);
+        axis->grid()->setPen(current.gridPen);
     }
-
-    // 递归更新子控件
-    const QObjectList& children = widget->children();
-    for (QObject* child : children) {
-        if (QWidget* childWidget = qobject_cast<QWidget*>(child)) {
-            updateWidgetStyle(childWidget);
-        }
+    for (int i = 0; i < plot->graphCount(); ++i) {
+        plot->graph(i)->setPen(current.linePen);
     }
 }
 
@@ -140,6 +155,7 @@ void ThemeManager::initializeColorMaps()
     // 浅色主题颜色
     m_lightColors["window"] = QColor(255, 255, 255);
     m_lightColors["base"] = QColor(255, 255, 255);
+    m_lightColors["alternateBase"] = QColor(248, 248, 248);
     m_lightColors["text"] = QColor(0, 0, 0);
     m_lightColors["button"] = QColor(240, 240, 240);
     m_lightColors["highlight"] = QColor(224, 224, 224);
@@ -153,6 +169,7 @@ void ThemeManager::initializeColorMaps()
     // 深色主题颜色
     m_darkColors["window"] = QColor(43, 43, 43);
     m_darkColors["base"] = QColor(43, 43, 43);
+    m_darkColors["alternateBase"] = QColor(51, 51, 51);
     m_darkColors["text"] = QColor(255, 255, 255);
     m_darkColors["button"] = QColor(68, 68, 68);
     m_darkColors["highlight"] = QColor(68, 68, 68);
@@ -163,3 +180,97 @@ void ThemeManager::initializeColorMaps()
     m_darkColors["positive"] = QColor(255, 100, 100);  // 涨为浅红色
     m_darkColors["negative"] = QColor(100, 255, 100);  // 跌为浅绿色
 }
+
+void ThemeManager::compileThemes()
+{
+    m_styleSheet = loadStyleSheet(":/resources/theme.qss");
+
+    m_lightTheme.palette = buildPalette(m_lightColors);
+    m_darkTheme.palette = buildPalette(m_darkColors);
+
+    m_lightTheme.chartBackground = QBrush(QColor(255, 255, 255));
+    m_lightTheme.chartText = Qt::black;
+    m_lightTheme.axisPen = QPen(Qt::black);
+    m_lightTheme.gridPen = QPen(QColor(200, 200, 200), 0, Qt::DotLine);
+    m_lightTheme.linePen = QPen(QColor(0, 102, 204), 2);
+
+    m_darkTheme.chartBackground = QBrush(QColor(43, 43, 43));
+    m_darkTheme.chartText = Qt::white;
+    m_darkTheme.axisPen = QPen(Qt::white);
+    m_darkTheme.gridPen = QPen(QColor(80, 80, 80), 0, Qt::DotLine);
+    m_darkTheme.linePen = QPen(QColor(255, 100, 100), 2);
+}
+
+int ThemeManager::benchmark(int count)
+{
+    ThemeManager& manager = instance();
+
+    // 与主窗口相近的控件树：标题栏、控制栏、200行的表格和状态标签
+    QWidget window;
+    window.setObjectName("centralWidget");
+    QVBoxLayout* layout = new QVBoxLayout(&window);
+    QWidget* titleBar = new QWidget(&window);
+    titleBar->setObjectName("titleBar");
+    QHBoxLayout* titleLayout = new QHBoxLayout(titleBar);
+    titleLayout->addWidget(new QLabel("TickerLite", titleBar));
+    for (const char* text : {"Light", "━", "□", "✕"}) {
+        titleLayout->addWidget(new QPushButton(text, titleBar));
+    }
+    QHBoxLayout* controlLayout = new QHBoxLayout();
+    for (const char* text : {"历史", "刷新", "多图"}) {
+        controlLayout->addWidget(new QPushButton(text, &window));
+    }
+    controlLayout->addWidget(new QComboBox(&window));
+    controlLayout->addWidget(new QLineEdit(&window));
+    QLabel* statusLabel = new QLabel("准备就绪", &window);
+    statusLabel->setObjectName("statusLabel");
+    controlLayout->addWidget(statusLabel);
+    QTableWidget* table = new QTableWidget(200, 12, &window);
+    table->setAlternatingRowColors(true);
+    for (int row = 0; row < table->rowCount(); ++row) {
+        for (int column = 0; column < table->columnCount(); ++column) {
+            table->setItem(row, column, new QTableWidgetItem(QString::number(row * column)));
+        }
+    }
+    layout->addWidget(titleBar);
+    layout->addLayout(controlLayout);
+    layout->addWidget(table);
+
+    manager.addStyledWidget(&window);
+    manager.addStyledWidget(titleBar);
+    manager.addStyledWidget(statusLabel);
+    manager.setTheme(Light);
+    window.resize(800, 600);
+    window.show();
+
+    // 等窗口真正显示后再计时
+    QElapsedTimer timer;
+    timer.start();
+    while ((!window.windowHandle() || !window.windowHandle()->isExposed()) && timer.elapsed() < 2000) {
+        QApplication::processEvents(QEventLoop::AllEvents, 50);
+    }
+
+    // 每次切换后处理事件，包括控件重绘
+    const int widgetCount = window.findChildren<QWidget*>().size() + 1;
+    timer.restart();
+    for (int i = 0; i < count; ++i) {
+        manager.setTheme(manager.isDarkTheme() ? Light : Dark);
+        QApplication::processEvents();
+    }
+    const qint64 paletteNs = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < count; ++i) {
+        window.setProperty("darkTheme", !window.property("darkTheme").toBool());
+        repolishAll(&window);
+        QApplication::processEvents();
+    }
+    const qint64 repolishNs = timer.nsecsElapsed();
+
+    manager.m_styledWidgets.clear();
+
+    qInfo() << "主题切换测试:" << widgetCount << "个控件," << count << "次切换";
+    qInfo().noquote() << QString("  替换调色板             %1 ms/次").arg(paletteNs / 1e6 / count, 0, 'f', 3);
+    qInfo().noquote() << QString("  逐个重新polish全部控件  %1 ms/次").arg(repolishNs / 1e6 / count, 0, 'f', 3);
+    return 0;
+}
@@ -0,0 +1,435 @@
+#include "tickcodec.h"
+#include "databasehelper.h"
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const quint32 ArchiveMagic = 0x544B5A31;  // "TKZ1"
+const quint32 ArchiveVersion = 1;
+
+// 归档文件中各列的顺序和差分阶数
+struct ColumnSpec {
+    QVector<qint64> TickRows::*column;
+    int deltaOrder;
+};
+
+const ColumnSpec ArchiveColumns[] = {
+    { &TickRows::timestamps, 2 },
+    { &TickRows::prices, 1 },
+    { &TickRows::prevCloses, 1 },
+    { &TickRows::openPrices, 1 },
+    { &TickRows::volumes, 1 },
+    { &TickRows::outerDiscs, 1 },
+    { &TickRows::innerDiscs, 1 },
+};
+
+inline quint64 zigzag(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+inline qint64 unzigzag(quint64 value)
+{
+    return qint64((value >> 1) ^ (0 - (value & 1)));
+}
+
+// 按固定位宽解包，packed须在末尾多留一个字
+void unpack(const quint64 *packed, int width, int count, quint64 *out)
+{
+    // 位宽为0时块内没有数据字，packed只有末尾补的一个字
+    if (width == 0) {
+        std::memset(out, 0, count * sizeof(quint64));
+        return;
+    }
+    if (width == 64) {
+        std::memcpy(out, packed, count * sizeof(quint64));
+        return;
+    }
+
+    const quint64 mask = (quint64(1) << width) - 1;
+    for (int i = 0; i < count; ++i) {
+        const quint64 bitPos = quint64(i) * width;
+        const quint64 word = bitPos >> 6;
+        const int shift = int(bitPos & 63);
+        // 先左移1位再移(63 - shift)位，shift为0时不会出现移位64的未定义行为
+        out[i] = ((packed[word] >> shift) | ((packed[word + 1] << 1) << (63 - shift))) & mask;
+    }
+}
+
+} // namespace
+
+QByteArray TickCodec::encode(const QVector<qint64> &values, int deltaOrder)
+{
+    QByteArray out;
+    quint64 residuals[BlockSize];
+    quint64 packed[BlockSize + 1];
+    quint64 previous = 0;
+    quint64 previousDelta = 0;
+
+    for (int start = 0; start < values.size(); start += BlockSize) {
+        const int count = qMin<int>(BlockSize, values.size() - start);
+
+        // 差分用无符号运算，溢出时按模回绕，解码时同样回绕即可还原
+        quint64 bits = 0;
+        for (int i = 0; i < count; ++i) {
+            const quint64 value = quint64(values.at(start + i));
+            quint64 residual = value;
+            if (deltaOrder >= 1) {
+                const quint64 delta = value - previous;
+                previous = value;
+                residual = delta;
+                if (deltaOrder >= 2) {
+                    residual = delta - previousDelta;
+                    previousDelta = delta;
+                }
+            }
+            residuals[i] = zigzag(qint64(residual));
+            bits |= residuals[i];
+        }
+
+        const int width = bits ? 64 - int(qCountLeadingZeroBits(bits)) : 0;
+        const int words = (count * width + 63) / 64;
+        std::memset(packed, 0, sizeof(packed));
+        for (int i = 0; i < count && width > 0; ++i) {
+            const int bitPos = i * width;
+            const int word = bitPos >> 6;
+            const int shift = bitPos & 63;
+            packed[word] |= residuals[i] << shift;
+            if (shift + width > 64) {
+                packed[word + 1] |= residuals[i] >> (64 - shift);
+            }
+        }
+
+        out.append(char(width));
+        out.append(reinterpret_cast<const char *>(packed), words * int(sizeof(quint64)));
+    }
+
+    return out;
+}
+
+bool TickCodec::decode(const QByteArray &data, int count, int deltaOrder, QVector<qint64> &values)
+{
+    values.resize(count);
+
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    const uchar *end = p + data.size();
+    quint64 packed[BlockSize + 1];
+    quint64 residuals[BlockSize];
+    quint64 previous = 0;
+    quint64 previousDelta = 0;
+
+    for (int start = 0; start < count; start += BlockSize) {
+        const int blockCount = qMin<int>(BlockSize, count - start);
+        if (p >= end || *p > 64) {
+            return false;
+        }
+
+        const int width = *p++;
+        const int words = (blockCount * width + 63) / 64;
+        if (end - p < qint64(words) * 8) {
+            return false;
+        }
+        std::memcpy(packed, p, words * sizeof(quint64));
+        packed[words] = 0;
+        p += words * sizeof(quint64);
+
+        unpack(packed, width, blockCount, residuals);
+
+        // zigzag还原和前缀和都是顺序的定长循环
+        qint64 *out = values.data() + start;
+        for (int i = 0; i < blockCount; ++i) {
+            out[i] = unzigzag(residuals[i]);
+        }
+
+        if (deltaOrder >= 2) {
+            for (int i = 0; i < blockCount; ++i) {
+                previousDelta += quint64(out[i]);
+                out[i] = qint64(previousDelta);
+            }
+        }
+        if (deltaOrder >= 1) {
+            for (int i = 0; i < blockCount; ++i) {
+                previous += quint64(out[i]);
+                out[i] = qint64(previous);
+            }
+        }
+    }
+
+    return p == end;
+}
+
+int TickRows::lowerBound(qint64 timestamp) const
+{
+    return int(std::lower_bound(timestamps.constBegin(), timestamps.constEnd(), timestamp) - timestamps.constBegin());
+}
+
+int TickRows::upperBound(qint64 timestamp) const
+{
+    return int(std::upper_bound(timestamps.constBegin(), timestamps.constEnd(), timestamp) - timestamps.constBegin());
+}
+
+double TickRows::change(int i) const
+{
+    return TickCodec::fromFixed(prices.at(i) - prevCloses.at(i));
+}
+
+double TickRows::changePercent(int i) const
+{
+    const double prevClose = TickCodec::fromFixed(prevCloses.at(i));
+    return prevClose != 0.0 ? qRound(change(i) / prevClose * 10000) / 100.0 : 0.0;
+}
+
+void TickRows::clear()
+{
+    name.clear();
+    for (const ColumnSpec &spec : ArchiveColumns) {
+        (this->*spec.column).clear();
+    }
+}
+
+void TickRows::append(qint64 timestamp, double price, double prevClose, double openPrice,
+                      qint64 volume, qint64 outerDisc, qint64 innerDisc)
+{
+    timestamps.append(timestamp);
+    prices.append(TickCodec::toFixed(price));
+    prevCloses.append(TickCodec::toFixed(prevClose));
+    openPrices.append(TickCodec::toFixed(openPrice));
+    volumes.append(volume);
+    outerDiscs.append(outerDisc);
+    innerDiscs.append(innerDisc);
+}
+
+TickArchive::Writer::Writer(const QString &path)
+    : m_file(path)
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "创建归档文件失败:" << path << m_file.errorString();
+        return;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_5_0);
+    m_stream << ArchiveMagic << ArchiveVersion;
+}
+
+bool TickArchive::Writer::add(const TickRows &rows)
+{
+    if (!isOpen() || rows.stockCode.isEmpty()) {
+        return false;
+    }
+
+    m_stream << rows.stockCode << rows.name << qint32(rows.size());
+    for (const ColumnSpec &spec : ArchiveColumns) {
+        m_stream << TickCodec::encode(rows.*spec.column, spec.deltaOrder);
+    }
+
+    m_rowCount += rows.size();
+    return m_stream.status() == QDataStream::Ok;
+}
+
+bool TickArchive::Writer::finish()
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    // 空代码作为结束标记
+    m_stream << QString();
+    bool success = m_stream.status() == QDataStream::Ok && m_file.error() == QFile::NoError;
+    m_file.close();
+    return success;
+}
+
+TickArchive::Reader::Reader(const QString &path)
+    : m_file(path)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    m_stream >> magic >> version;
+    m_valid = (magic == ArchiveMagic && version == ArchiveVersion);
+    if (!m_valid) {
+        qDebug() << "归档文件格式不匹配:" << path;
+    }
+}
+
+bool TickArchive::Reader::next(TickRows &rows)
+{
+    return nextCode(rows.stockCode) && read(rows);
+}
+
+bool TickArchive::Reader::nextCode(QString &stockCode)
+{
+    if (!m_valid) {
+        return false;
+    }
+
+    m_stream >> m_stockCode;
+    if (m_stockCode.isEmpty()) {
+        // 文件截断时读不到结束标记
+        m_valid = (m_stream.status() == QDataStream::Ok);
+        return false;
+    }
+    m_stream >> m_name >> m_count;
+    if (m_stream.status() != QDataStream::Ok || m_count < 0) {
+        m_valid = false;
+        return false;
+    }
+
+    stockCode = m_stockCode;
+    return true;
+}
+
+bool TickArchive::Reader::read(TickRows &rows)
+{
+    if (!m_valid) {
+        return false;
+    }
+
+    rows.stockCode = m_stockCode;
+    rows.name = m_name;
+    for (const ColumnSpec &spec : ArchiveColumns) {
+        QByteArray data;
+        m_stream >> data;
+        if (!TickCodec::decode(data, m_count, spec.deltaOrder, rows.*spec.column)) {
+            qDebug() << "归档数据损坏:" << m_stockCode;
+            m_valid = false;
+            return false;
+        }
+    }
+
+    if (m_stream.status() != QDataStream::Ok) {
+        m_valid = false;
+        return false;
+    }
+    return true;
+}
+
+bool TickArchive::Reader::skip()
+{
+    if (!m_valid) {
+        return false;
+    }
+
+    // 每列是带长度前缀的QByteArray，按长度跳过，不分配也不解码
+    for (int i = 0; i < int(sizeof(ArchiveColumns) / sizeof(ArchiveColumns[0])); ++i) {
+        quint32 length = 0;
+        m_stream >> length;
+        if (length != 0xFFFFFFFFu && m_stream.skipRawData(int(length)) != int(length)) {
+            m_valid = false;
+            return false;
+        }
+    }
+
+    if (m_stream.status() != QDataStream::Ok) {
+        m_valid = false;
+        return false;
+    }
+    return true;
+}
+
+bool TickArchive::readRows(QSqlDatabase &db, const QString &table, const QString &stockCode, TickRows &rows)
+{
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT name, timestamp, price, prev_close, open_price, volume, outer_disc, inner_disc "
+                          "FROM %1 WHERE stock_code = ? ORDER BY timestamp").arg(table));
+    query.addBindValue(stockCode);
+
+    if (!query.exec()) {
+        qDebug() << "读取tick失败:" << stockCode << query.lastError().text();
+        return false;
+    }
+
+    rows.stockCode = stockCode;
+    while (query.next()) {
+        rows.name = query.value(0).toString();
+        rows.append(query.value(1).toLongLong(), query.value(2).toDouble(), query.value(3).toDouble(),
+                    query.value(4).toDouble(), query.value(5).toLongLong(), query.value(6).toLongLong(),
+                    query.value(7).toLongLong());
+    }
+    return true;
+}
+
+bool TickArchive::readRows(const QString &path, const QString &stockCode, TickRows &rows)
+{
+    Reader reader(path);
+    if (!reader.isOpen()) {
+        return false;
+    }
+
+    QString code;
+    while (reader.nextCode(code)) {
+        if (code != stockCode) {
+            reader.skip();
+            continue;
+        }
+
+        TickRows segment;
+        if (!reader.read(segment)) {
+            return false;
+        }
+
+        rows.stockCode = stockCode;
+        rows.name = segment.name;
+        for (const ColumnSpec &spec : ArchiveColumns) {
+            rows.*spec.column += segment.*spec.column;
+        }
+        return true;
+    }
+
+    // 没有这只股票不算失败，读到损坏的数据时读取器失效
+    return reader.isOpen();
+}
+
+QStringList TickArchive::stockCodes(const QString &path)
+{
+    QStringList codes;
+    Reader reader(path);
+
+    QString code;
+    while (reader.nextCode(code) && reader.skip()) {
+        codes.append(code);
+    }
+    return codes;
+}
+
+bool TickArchive::encodeTable(QSqlDatabase &db, const QString &table, const QString &path)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Writer writer(path);
+    if (!writer.isOpen()) {
+        return false;
+    }
+
+    const QStringList codes = DatabaseHelper::listStockCodes(db, table);
+    for (const QString &code : codes) {
+        TickRows rows;
+        if (!readRows(db, table, code, rows) || !writer.add(rows)) {
+            return false;
+        }
+    }
+
+    if (!writer.finish()) {
+        return false;
+    }
+
+    qDebug() << "编码tick归档:" << QFileInfo(path).fileName() << writer.rowCount() << "笔,"
+             << QFileInfo(path).size() << "字节, 耗时" << timer.elapsed() << "ms";
+    return true;
+}
@@ -0,0 +1,403 @@
+#include "tickpartitions.h"
+#include "databasehelper.h"
+#include "tickcodec.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+namespace {
+
+const qint64 DayMs = 86400000LL;
+
+// 与 overlapping() 等查询的列顺序一致
+TickPartitions::Partition readPartition(const QSqlQuery &query)
+{
+    TickPartitions::Partition partition;
+    partition.key = query.value(0).toString();
+    partition.startTime = query.value(1).toLongLong();
+    partition.endTime = query.value(2).toLongLong();
+    partition.rowCount = query.value(3).toLongLong();
+    partition.sealed = query.value(4).toBool();
+    partition.compressed = query.value(5).toBool();
+    return partition;
+}
+
+} // namespace
+
+bool TickPartitions::ensureCatalog(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    bool success = query.exec(
+        "CREATE TABLE IF NOT EXISTS partitions ("
+        "partition_key TEXT PRIMARY KEY, "
+        "start_time INTEGER NOT NULL, "
+        "end_time INTEGER NOT NULL, "
+        "min_ts INTEGER, "
+        "max_ts INTEGER, "
+        "row_count INTEGER NOT NULL DEFAULT 0, "
+        "sealed INTEGER NOT NULL DEFAULT 0, "
+        "compressed INTEGER NOT NULL DEFAULT 0"
+        ")"
+    );
+
+    if (success) {
+        success = query.exec("CREATE INDEX IF NOT EXISTS idx_partitions_time ON partitions(start_time, end_time)");
+    }
+
+    if (!success) {
+        qDebug() << "创建分区目录失败:" << query.lastError().text();
+    }
+    return success;
+}
+
+TickPartitions::Partition TickPartitions::partitionFor(qint64 timestamp, Granularity granularity)
+{
+    QDate date = QDateTime::fromMSecsSinceEpoch(timestamp).date();
+
+    Partition partition;
+    if (granularity == Weekly) {
+        QDate monday = date.addDays(1 - date.dayOfWeek());
+        partition.key = "w" + monday.toString("yyyyMMdd");
+        partition.startTime = monday.startOfDay().toMSecsSinceEpoch();
+        partition.endTime = monday.addDays(7).startOfDay().toMSecsSinceEpoch();
+    } else {
+        partition.key = date.toString("yyyyMMdd");
+        partition.startTime = date.startOfDay().toMSecsSinceEpoch();
+        partition.endTime = date.addDays(1).startOfDay().toMSecsSinceEpoch();
+    }
+    return partition;
+}
+
+bool TickPartitions::registerPartition(QSqlDatabase &db, Partition &partition)
+{
+    QSqlQuery query(db);
+    query.prepare("INSERT OR IGNORE INTO partitions (partition_key, start_time, end_time) VALUES (?, ?, ?)");
+    query.addBindValue(partition.key);
+    query.addBindValue(partition.startTime);
+    query.addBindValue(partition.endTime);
+
+    if (!query.exec()) {
+        qDebug() << "登记分区失败:" << partition.key << query.lastError().text();
+        return false;
+    }
+
+    query.prepare("SELECT partition_key, start_time, end_time, row_count, sealed, compressed "
+                  "FROM partitions WHERE partition_key = ?");
+    query.addBindValue(partition.key);
+    if (!query.exec() || !query.next()) {
+        qDebug() << "读取分区失败:" << partition.key << query.lastError().text();
+        return false;
+    }
+
+    partition = readPartition(query);
+    return true;
+}
+
+QList<TickPartitions::Partition> TickPartitions::overlapping(QSqlDatabase &db, qint64 fromMs, qint64 toMs,
+                                                             bool newestFirst)
+{
+    QList<Partition> result;
+
+    // 已封存的分区用实际数据范围进一步裁剪，空分区直接跳过
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT partition_key, start_time, end_time, row_count, sealed, compressed "
+                          "FROM partitions WHERE start_time <= ? AND end_time > ? "
+                          "AND (sealed = 0 OR (row_count > 0 AND min_ts <= ? AND max_ts >= ?)) "
+                          "ORDER BY start_time %1").arg(newestFirst ? "DESC" : "ASC"));
+    query.addBindValue(toMs);
+    query.addBindValue(fromMs);
+    query.addBindValue(toMs);
+    query.addBindValue(fromMs);
+
+    if (!query.exec()) {
+        qDebug() << "查询分区失败:" << query.lastError().text();
+        return result;
+    }
+
+    while (query.next()) {
+        result.append(readPartition(query));
+    }
+    return result;
+}
+
+QList<TickPartitions::Partition> TickPartitions::endedBefore(QSqlDatabase &db, qint64 cutoff, int limit)
+{
+    QList<Partition> result;
+
+    // 只返回已封存的分区，封存前可能仍在写入
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT partition_key, start_time, end_time, row_count, sealed, compressed "
+                  "FROM partitions WHERE end_time <= ? AND sealed = 1 "
+                  "ORDER BY start_time LIMIT ?");
+    query.addBindValue(cutoff);
+    query.addBindValue(limit);
+
+    if (!query.exec()) {
+        qDebug() << "查询过期分区失败:" << query.lastError().text();
+        return result;
+    }
+
+    while (query.next()) {
+        result.append(readPartition(query));
+    }
+    return result;
+}
+
+QString TickPartitions::directory()
+{
+    QFileInfo dbInfo(DatabaseHelper::instance().databasePath());
+    return dbInfo.absolutePath() + "/partitions";
+}
+
+QString TickPartitions::filePath(const QString &key)
+{
+    return directory() + "/ticks_" + key + ".db";
+}
+
+QString TickPartitions::compressedPath(const QString &key)
+{
+    return directory() + "/ticks_" + key + ".tkz";
+}
+
+QString TickPartitions::openablePath(const Partition &partition)
+{
+    // 挂载不存在的文件会创建空库，必须先确认文件存在
+    if (partition.compressed) {
+        return QString();
+    }
+
+    QString path = filePath(partition.key);
+    return QFile::exists(path) ? path : QString();
+}
+
+QString TickPartitions::archivePath(const Partition &partition)
+{
+    if (!partition.compressed) {
+        return QString();
+    }
+
+    QString path = compressedPath(partition.key);
+    return QFile::exists(path) ? path : QString();
+}
+
+void TickPartitions::sealPartitions(const QString &currentKey, int compressAfterDays)
+{
+    DatabaseHelper::Connection connection("seal_partitions");
+    if (!connection.isOpen()) {
+        return;
+    }
+
+    QSqlDatabase db = connection.database();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QList<Partition> pending;
+    {
+        QSqlQuery query(db);
+        query.prepare("SELECT partition_key, start_time, end_time, row_count, sealed, compressed "
+                      "FROM partitions WHERE partition_key <> ? AND end_time <= ? "
+                      "AND (sealed = 0 OR compressed = 0) ORDER BY start_time");
+        query.addBindValue(currentKey);
+        query.addBindValue(now);
+
+        if (!query.exec()) {
+            qDebug() << "查询待封存分区失败:" << query.lastError().text();
+            return;
+        }
+
+        while (query.next()) {
+            pending.append(readPartition(query));
+        }
+    }
+
+    for (Partition &partition : pending) {
+        QString path = filePath(partition.key);
+
+        if (!partition.sealed) {
+            if (!QFile::exists(path)) {
+                continue;
+            }
+
+            bool counted = false;
+            QVariant minTs;
+            QVariant maxTs;
+            {
+                DatabaseHelper::Connection file(QString("seal_%1").arg(partition.key), path);
+                if (!file.isOpen()) {
+                    continue;
+                }
+
+                QSqlDatabase fileDb = file.database();
+                QSqlQuery query(fileDb);
+                if (query.exec("SELECT COUNT(*), MIN(timestamp), MAX(timestamp) FROM stock_data") && query.next()) {
+                    partition.rowCount = query.value(0).toLongLong();
+                    minTs = query.value(1);
+                    maxTs = query.value(2);
+                    counted = true;
+                }
+                query.finish();
+
+                // 补上较早版本建的分区缺少的索引，封存后不再修改
+                DatabaseHelper::createTickTable(fileDb, "main");
+
+                // 封存后只读，切回普通日志模式并整理成紧凑文件
+                if (!query.exec("PRAGMA journal_mode=DELETE") || !query.exec("VACUUM")) {
+                    qDebug() << "整理分区失败:" << partition.key << query.lastError().text();
+                }
+            }
+
+            if (!counted) {
+                continue;
+            }
+
+            QSqlQuery query(db);
+            query.prepare("UPDATE partitions SET sealed = 1, row_count = ?, min_ts = ?, max_ts = ? "
+                          "WHERE partition_key = ?");
+            query.addBindValue(partition.rowCount);
+            query.addBindValue(minTs);
+            query.addBindValue(maxTs);
+            query.addBindValue(partition.key);
+            if (!query.exec()) {
+                qDebug() << "封存分区失败:" << partition.key << query.lastError().text();
+                continue;
+            }
+            partition.sealed = true;
+        }
+
+        if (compressAfterDays < 0 || partition.compressed
+            || partition.endTime > now - compressAfterDays * DayMs) {
+            continue;
+        }
+
+        QString target = compressedPath(partition.key);
+        if (!compressFile(path, target)) {
+            qDebug() << "压缩分区失败:" << partition.key;
+            QFile::remove(target);
+            continue;
+        }
+
+        QSqlQuery query(db);
+        query.prepare("UPDATE partitions SET compressed = 1 WHERE partition_key = ?");
+        query.addBindValue(partition.key);
+        if (query.exec()) {
+            QFile::remove(path);
+        }
+        else {
+            QFile::remove(target);
+        }
+    }
+}
+
+bool TickPartitions::retirePartition(QSqlDatabase &db, const Partition &partition, bool archive)
+{
+    // 先把分区内每只股票的tick补齐为K线，已有的增量K线保持不变
+    QString path = openablePath(partition);
+    if (!path.isEmpty()) {
+        if (!DatabaseHelper::attachDatabase(db, path, "part", partition.sealed)) {
+            return false;
+        }
+
+        bool success = true;
+        const QStringList codes = DatabaseHelper::listStockCodes(db, "part.stock_data");
+        for (const QString &code : codes) {
+            QVector<QVector<StockBar>> bars;
+            success = DatabaseHelper::aggregateTicks(db, code, partition.startTime, partition.endTime,
+                                                     bars, "part.stock_data")
+                      && db.transaction();
+            if (success) {
+                success = DatabaseHelper::writeBars(db, code, bars, false) && db.commit();
+                if (!success) {
+                    db.rollback();
+                }
+            }
+            if (!success) {
+                break;
+            }
+        }
+
+        DatabaseHelper::detachDatabase(db, "part");
+        if (!success) {
+            qDebug() << "分区K线补齐失败:" << partition.key;
+            return false;
+        }
+    }
+
+    // 压缩分区逐只股票解码归档后聚合，不还原为SQLite
+    QString archive = archivePath(partition);
+    if (!archive.isEmpty()) {
+        TickArchive::Reader reader(archive);
+        bool success = reader.isOpen();
+        TickRows rows;
+        while (success && reader.next(rows)) {
+            QVector<QVector<StockBar>> bars;
+            DatabaseHelper::aggregateTicks(rows, partition.startTime, partition.endTime, bars);
+            success = db.transaction();
+            if (success) {
+                success = DatabaseHelper::writeBars(db, rows.stockCode, bars, false) && db.commit();
+                if (!success) {
+                    db.rollback();
+                }
+            }
+        }
+
+        if (!success || !reader.isOpen()) {
+            qDebug() << "分区K线补齐失败:" << partition.key;
+            return false;
+        }
+    }
+
+    // 原始文件移入归档目录，日志文件直接删除
+    QFileInfo dbInfo(DatabaseHelper::instance().databasePath());
+    QString archiveDir = dbInfo.absolutePath() + "/archive";
+    for (const QString &file : { filePath(partition.key), compressedPath(partition.key) }) {
+        if (!QFile::exists(file)) {
+            continue;
+        }
+
+        if (archive) {
+            QDir().mkpath(archiveDir);
+            QString target = archiveDir + "/" + QFileInfo(file).fileName();
+            QFile::remove(target);
+            if (QFile::rename(file, target)) {
+                continue;
+            }
+        }
+        QFile::remove(file);
+    }
+
+    QString plainPath = filePath(partition.key);
+    for (const QString &file : { plainPath + "-wal", plainPath + "-shm" }) {
+        QFile::remove(file);
+    }
+
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM partitions WHERE partition_key = ?");
+    query.addBindValue(partition.key);
+    if (!query.exec()) {
+        qDebug() << "删除分区目录项失败:" << partition.key << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+bool TickPartitions::compressFile(const QString &source, const QString &target)
+{
+    if (!QFile::exists(source)) {
+        return false;
+    }
+
+    // 按列重新编码，只保存行情字段的差分，比压缩整个SQLite文件小一个数量级
+    DatabaseHelper::Connection connection("compress_" + QFileInfo(source).fileName(), source);
+    if (!connection.isOpen()) {
+        return false;
+    }
+
+    QSqlDatabase db = connection.database();
+    return TickArchive::encodeTable(db, "stock_data", target);
+}
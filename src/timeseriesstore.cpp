@@ -0,0 +1,120 @@
+#include "timeseriesstore.h"
+#include <QVector>
+#include <QPair>
+#include <algorithm>
+
+TimeSeriesStore::TimeSeriesStore(int defaultCapacity)
+    : m_defaultCapacity(defaultCapacity)
+    , m_memoryLimit(0)
+    , m_memoryUsage(0)
+    , m_clock(0)
+    , m_evictedCount(0)
+{
+}
+
+void TimeSeriesStore::setCapacity(const QString &stockCode, int capacity)
+{
+    m_capacity.insert(stockCode, capacity);
+}
+
+void TimeSeriesStore::setMemoryLimit(qint64 bytes)
+{
+    m_memoryLimit = bytes;
+    evictIfNeeded();
+}
+
+void TimeSeriesStore::setActive(const QString &stockCode)
+{
+    m_active = stockCode;
+    touch(stockCode);
+}
+
+void TimeSeriesStore::touch(const QString &stockCode)
+{
+    m_evicted.remove(stockCode);
+    auto it = m_entries.find(stockCode);
+    if (it != m_entries.end()) {
+        it->lastUsed = ++m_clock;
+    }
+}
+
+bool TimeSeriesStore::append(const QString &stockCode, double key, double value)
+{
+    // 重新创建被淘汰的序列只会再次超出上限，淘汰掉别的序列
+    auto it = m_entries.find(stockCode);
+    if (it != m_entries.end()) {
+        return it->series->append(key, value);
+    }
+    if (m_evicted.contains(stockCode)) {
+        return false;
+    }
+    return ensure(stockCode)->append(key, value);
+}
+
+TimeSeriesStore::Series *TimeSeriesStore::series(const QString &stockCode) const
+{
+    auto it = m_entries.constFind(stockCode);
+    return it == m_entries.constEnd() ? nullptr : it->series.data();
+}
+
+TimeSeriesStore::Series *TimeSeriesStore::ensure(const QString &stockCode)
+{
+    auto it = m_entries.find(stockCode);
+    if (it == m_entries.end()) {
+        m_evicted.remove(stockCode);
+        Entry entry;
+        entry.series.reset(new Series(m_capacity.value(stockCode, m_defaultCapacity)));
+        m_memoryUsage += bytesFor(entry.series->capacity());
+        it = m_entries.insert(stockCode, entry);
+
+        // 新序列本身不参与本次淘汰
+        it->lastUsed = ++m_clock;
+        QSharedPointer<Series> created = it->series;
+        evictIfNeeded();
+        return created.data();
+    }
+
+    return it->series.data();
+}
+
+qint64 TimeSeriesStore::memoryUsage(const QString &stockCode) const
+{
+    auto it = m_entries.constFind(stockCode);
+    return it == m_entries.constEnd() ? 0 : bytesFor(it->series->capacity());
+}
+
+qint64 TimeSeriesStore::bytesFor(int capacity)
+{
+    return qint64(sizeof(Series)) + qint64(capacity) * qint64(sizeof(double) * 2);
+}
+
+void TimeSeriesStore::evictIfNeeded()
+{
+    if (m_memoryLimit <= 0 || m_memoryUsage <= m_memoryLimit) {
+        return;
+    }
+
+    // 按最近使用时间从旧到新淘汰，直到降到上限的90%
+    const qint64 target = m_memoryLimit / 10 * 9;
+    QVector<QPair<quint64, QString>> candidates;
+    candidates.reserve(m_entries.size());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        if (it.key() != m_active && it->lastUsed != m_clock) {
+            candidates.append(qMakePair(it->lastUsed, it.key()));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    int evicted = 0;
+    for (const auto &candidate : qAsConst(candidates)) {
+        if (m_memoryUsage <= target) {
+            break;
+        }
+        m_memoryUsage -= memoryUsage(candidate.second);
+        m_entries.remove(candidate.second);
+        m_evicted.insert(candidate.second);
+        ++evicted;
+    }
+
+    m_evictedCount += evicted;
+}